@@ -1,11 +1,49 @@
 #include "Actor.h"
+#include "FlowField.h"
 #include "StudentWorld.h"
 
+#include <new>
 #include <random>
+#include <vector>
+
+// Free lists of actor-sized chunks, one for every size of actor in steps of
+// POOL_ALIGN bytes, so in practice one per type of actor. Chunks are carved
+// out of blocks of ACTORS_PER_BLOCK at a time; a deleted actor's chunk goes
+// back on its list for the next actor of that size, and the blocks are kept
+// for the life of the program.
+static const size_t POOL_ALIGN = alignof(max_align_t);
+static const size_t ACTORS_PER_BLOCK = 64;
+
+static vector<void *> &actorPool(size_t size) {
+  // never destroyed, so actors can still be deleted while the program exits
+  static vector<vector<void *>> &pools = *new vector<vector<void *>>;
+  size_t sizeClass = (size + POOL_ALIGN - 1) / POOL_ALIGN;
+  if (sizeClass >= pools.size())
+    pools.resize(sizeClass + 1);
+  return pools[sizeClass];
+}
+
+void *Actor::operator new(size_t size) {
+  vector<void *> &pool = actorPool(size);
+  if (pool.empty()) {
+    size_t chunk = (size + POOL_ALIGN - 1) / POOL_ALIGN * POOL_ALIGN;
+    char *block = static_cast<char *>(::operator new(chunk * ACTORS_PER_BLOCK));
+    for (size_t i = ACTORS_PER_BLOCK; i > 0; i--)
+      pool.push_back(block + (i - 1) * chunk);
+  }
+  void *p = pool.back();
+  pool.pop_back();
+  return p;
+}
+
+void Actor::operator delete(void *p, size_t size) {
+  if (p != nullptr)
+    actorPool(size).push_back(p);
+}
 
 Actor::Actor(StudentWorld *world, int imageID, double x, double y,
-             Direction dir, int depth)
-    : GraphObject(imageID, x, y, dir, depth), m_world(world) {}
+             Direction dir, int depth, ActorKind kind)
+    : GraphObject(imageID, x, y, dir, depth), m_world(world), m_kind(kind) {}
 
 double Actor::offsetX(const Direction &dir, const double &dist) const {
   switch (dir) {
@@ -31,6 +69,12 @@ double Actor::offsetY(const Direction &dir, const double &dist) const {
 
 Penelope *Actor::player() const { return world()->player(); }
 
+void Actor::moveTo(double x, double y) {
+  int oldX = getX(), oldY = getY();
+  GraphObject::moveTo(x, y);
+  world()->actorMoved(this, oldX, oldY);
+}
+
 double Actor::overlaps(const Actor *obj) const {
   return world()->checkOverlap(this, obj);
 }
@@ -100,10 +144,10 @@ void Landmine::explode() {
 }
 
 Wall::Wall(StudentWorld *world, double x, double y)
-    : Actor(world, IID_WALL, x, y, RIGHT, 0) {}
+    : Actor(world, IID_WALL, x, y, RIGHT, 0, ACTOR_WALL) {}
 
 Landmine::Landmine(StudentWorld *world, double x, double y)
-    : Actor(world, IID_LANDMINE, x, y, RIGHT, 1) {}
+    : Actor(world, IID_LANDMINE, x, y, RIGHT, 1, ACTOR_HAZARD) {}
 
 void Exit::doSomething() {
   // I AM THE DOOR. If anyone enters by Me, he will be saved.
@@ -122,14 +166,39 @@ void Pit::doSomething() {
 }
 
 Agent::Agent(StudentWorld *world, int imageID, double x, double y,
-             const double &speed)
-    : Actor(world, imageID, x, y, RIGHT, 0), m_speed(speed) {}
+             const double &speed, ActorKind kind)
+    : Actor(world, imageID, x, y, RIGHT, 0, kind), m_speed(speed) {}
+
+// The way to the next cell along the field, toward its nearest source: first
+// lined up with that cell, so that the walls beside the way are not in it,
+// then straight on in. False once in a source's cell, or if no way leads to
+// one from here.
+bool Agent::followField(const FlowField &field, Direction &dir) const {
+  int const x = getX(), y = getY();
+  int nextX, nextY;
+  if (!field.next(x, y, nextX, nextY))
+    return false;
+  if (nextX == FlowField::cellX(x)) {
+    // up or down
+    if (x > nextX)
+      dir = LEFT;
+    else
+      dir = nextY > y ? UP : DOWN;
+  } else {
+    // right or left
+    if (y > nextY)
+      dir = DOWN;
+    else
+      dir = nextX > x ? RIGHT : LEFT;
+  }
+  return true;
+}
 
 bool Agent::isBlockedAtDir(const Direction &dir) const {
   return world()->checkBlockAtDir(this, dir, speed());
 }
 
-Direction Agent::getDirectionTowards(const Actor *target) const {
+Direction Agent::getDirectionTowards(const Actor *target) {
   Direction dir = 0;
   if (getX() == target->getX()) {
     if (target->getY() > getY())
@@ -151,14 +220,14 @@ Direction Agent::getDirectionTowards(const Actor *target) const {
     else if (isBlockedX && !isBlockedY)
       dir = dirY;
     else
-      dir = world()->bernoulliRandomBool(0.5) ? dirX : dirY;
+      dir = bernoulliRandomBool(0.5) ? dirX : dirY;
   }
   return dir;
 }
 
 Human::Human(StudentWorld *world, int imageID, double x, double y,
              const double &speed)
-    : Agent(world, imageID, x, y, speed) {}
+    : Agent(world, imageID, x, y, speed, ACTOR_HUMAN) {}
 
 void Human::updateInfection() {
   if (!isInfected())
@@ -268,6 +337,8 @@ void Citizen::doSomething() {
     if (isParalyzed())
       finishTurn();
   }
+  if (turnFinished())
+    return;
   double distToPenelope, distToZombie;
   distToPenelope = distTo(player());
   Actor *nearestZombie = world()->getNearestZombie(getX(), getY());
@@ -276,8 +347,12 @@ void Citizen::doSomething() {
   } else {
     distToZombie = VIEW_WIDTH * VIEW_WIDTH + VIEW_HEIGHT * VIEW_HEIGHT;
   }
-  if (!turnFinished() && distToPenelope <= distToZombie && isNear(player())) {
-    Direction potentialDir = getDirectionTowards(player());
+  if (distToPenelope <= distToZombie && isNear(player())) {
+    // around the walls to her, or straight for her if that way is blocked
+    Direction potentialDir;
+    if (!followField(world()->fieldTowardPenelope(), potentialDir) ||
+        isBlockedAtDir(potentialDir))
+      potentialDir = getDirectionTowards(player());
     if (!isBlockedAtDir(potentialDir)) {
       setDirection(potentialDir);
       moveTowards(potentialDir);
@@ -334,14 +409,14 @@ void Citizen::mutate() {
   scheduleRemoval();
   world()->playSound(SOUND_ZOMBIE_BORN);
   world()->increaseScore(SCORE_CITIZEN_DIE);
-  if (world()->bernoulliRandomBool(.7))
+  if (bernoulliRandomBool(.7))
     world()->addDumbZombie(getX(), getY());
   else
     world()->addSmartZombie(getX(), getY());
 }
 
 Zombie::Zombie(StudentWorld *world, double x, double y)
-    : Agent(world, IID_ZOMBIE, x, y, SPEED_ZOMBIE) {}
+    : Agent(world, IID_ZOMBIE, x, y, SPEED_ZOMBIE, ACTOR_ZOMBIE) {}
 
 void Zombie::doSomething() {
   Agent::doSomething();
@@ -362,7 +437,7 @@ bool Zombie::vomit() {
   double vomitY = offsetY(getDirection(), SPRITE_HEIGHT);
   if (world()->checkOverlapWithHuman(vomitX, vomitY)) {
     // there is a 1/3 chance that the zombie will vomit
-    if (world()->unifRandomInt(1, 3) == 1) {
+    if (unifRandomInt(1, 3) == 1) {
       world()->addVomit(vomitX, vomitY, getDirection());
       world()->playSound(SOUND_ZOMBIE_VOMIT);
       return true;
@@ -379,14 +454,26 @@ void Zombie::die() {
 void SmartZombie::doSomething() {
   Zombie::doSomething();
   if (!turnFinished() && getPlan() == 0) {
-    setPlan(world()->unifRandomInt(ZOMBIE_MOVEMENT_RANGE_MIN,
-                                   ZOMBIE_MOVEMENT_RANGE_MAX));
+    setPlan(
+        unifRandomInt(ZOMBIE_MOVEMENT_RANGE_MIN, ZOMBIE_MOVEMENT_RANGE_MAX));
     Actor *nearestHuman = world()->getNearestHuman(getX(), getY());
-    if (nearestHuman != nullptr && isNear(nearestHuman)) {
-      setDirection(getDirectionTowards(nearestHuman));
+    m_isChasing = nearestHuman != nullptr && isNear(nearestHuman);
+    if (m_isChasing) {
+      // around the walls to the nearest human, or straight for the one in
+      // sight if that way is blocked
+      Direction dir;
+      if (!followField(world()->fieldTowardHumans(), dir) ||
+          isBlockedAtDir(dir))
+        dir = getDirectionTowards(nearestHuman);
+      setDirection(dir);
     } else {
-      setDirection(world()->randomDirection());
+      setDirection(randomDirection());
     }
+  } else if (!turnFinished() && m_isChasing) {
+    // keep to the way around the walls, a step at a time
+    Direction dir;
+    if (followField(world()->fieldTowardHumans(), dir) && !isBlockedAtDir(dir))
+      setDirection(dir);
   }
   if (!turnFinished()) {
     if (!isBlockedAtDir(getDirection())) {
@@ -401,9 +488,9 @@ void SmartZombie::doSomething() {
 void DumbZombie::doSomething() {
   Zombie::doSomething();
   if (!turnFinished() && getPlan() == 0) {
-    setPlan(world()->unifRandomInt(ZOMBIE_MOVEMENT_RANGE_MIN,
-                                   ZOMBIE_MOVEMENT_RANGE_MAX));
-    setDirection(world()->randomDirection());
+    setPlan(
+        unifRandomInt(ZOMBIE_MOVEMENT_RANGE_MIN, ZOMBIE_MOVEMENT_RANGE_MAX));
+    setDirection(randomDirection());
   }
   if (!turnFinished()) {
     if (!isBlockedAtDir(getDirection())) {
@@ -422,8 +509,8 @@ void SmartZombie::die() {
 
 void DumbZombie::die() {
   Zombie::die();
-  if (world()->unifRandomInt(1, 10) == 1) {
-    Direction flingDir = world()->randomDirection();
+  if (unifRandomInt(1, 10) == 1) {
+    Direction flingDir = randomDirection();
     double vaccineX = offsetX(flingDir, SPRITE_WIDTH);
     double vaccineY = offsetY(flingDir, SPRITE_HEIGHT);
     world()->addVaccineGoodie(vaccineX, vaccineY);
@@ -1,18 +1,27 @@
 #ifndef ACTOR_H_
 #define ACTOR_H_
 
+#include "ActorStore.h"
 #include "GameConstants.h"
 #include "GraphObject.h"
+#include "Random.h"
+
+#include <cstddef>
 
 class StudentWorld;
 class Penelope;
+class FlowField;
 
 class Actor : public GraphObject {
 public:
   Actor(StudentWorld *world, int imageID, double x, double y, Direction dir,
-        int depth);
+        int depth, ActorKind kind);
   virtual ~Actor() {}
 
+  // actors come from pools, one per size of actor
+  static void *operator new(size_t size);
+  static void operator delete(void *p, size_t size);
+
   // Actions
   virtual void doSomething() {
     m_turnFinished = false;
@@ -26,12 +35,24 @@ public:
   // Accessors
   StudentWorld *world() const { return m_world; }
   Penelope *player() const;
-  virtual bool isHuman() const { return false; }
-  virtual bool isZombie() const { return false; }
-  virtual bool blocks() const { return false; }
-  virtual bool isFlammable() const { return true; }
+  ActorKind kind() const { return m_kind; }
+  bool isHuman() const { return m_kind == ACTOR_HUMAN; }
+  bool isZombie() const { return m_kind == ACTOR_ZOMBIE; }
+  bool blocks() const {
+    return m_kind == ACTOR_WALL || isHuman() || isZombie();
+  }
+  bool isFlammable() const {
+    return m_kind != ACTOR_WALL && m_kind != ACTOR_EXIT;
+  }
   bool willBeRemoved() const { return m_willBeRemoved; }
   bool turnFinished() const { return m_turnFinished; }
+  long spawnOrder() const { return m_spawnOrder; }
+  void setSpawnOrder(const long &order) { m_spawnOrder = order; }
+  ActorHandle handle() const { return m_handle; }
+  void setHandle(const ActorHandle &handle) { m_handle = handle; }
+
+  // keeps the world's spatial index up to date
+  virtual void moveTo(double x, double y);
 
   // helpers
   double overlaps(const Actor *obj) const;
@@ -42,6 +63,15 @@ public:
 
   void finishTurn() { m_turnFinished = true; }
 
+  // Random Generators, drawing from the actor's own stream, so what one actor
+  // draws does not depend on how many numbers the others drew before it
+  void setRandom(const Rng &random) { m_random = random; }
+  int unifRandomInt(const int &min, const int &max) {
+    return m_random.uniformInt(min, max);
+  }
+  bool bernoulliRandomBool(const double &p) { return m_random.bernoulli(p); }
+  Direction randomDirection() { return unifRandomInt(0, 3) * 90; }
+
   virtual void scheduleRemoval() {
     finishTurn();
     m_willBeRemoved = true;
@@ -49,6 +79,10 @@ public:
 
 private:
   StudentWorld *m_world;
+  ActorKind m_kind;
+  long m_spawnOrder = 0;
+  ActorHandle m_handle;
+  Rng m_random;
   bool m_turnFinished = false;
   bool m_willBeRemoved = false;
 };
@@ -56,21 +90,19 @@ private:
 class Wall : public Actor {
 public:
   Wall(StudentWorld *world, double x, double y);
-  virtual bool blocks() const { return true; }
-  virtual bool isFlammable() const { return false; }
   virtual void scheduleRemoval() {}
 };
 
 class Agent : public Actor {
 public:
   Agent(StudentWorld *world, int imageID, double x, double y,
-        const double &speed);
+        const double &speed, ActorKind kind);
 
-  virtual bool blocks() const { return true; }
   double speed() const { return m_speed; }
   bool isParalyzed() const { return m_isParalyzed; }
   bool isBlockedAtDir(const Direction &dir) const;
-  Direction getDirectionTowards(const Actor *target) const;
+  Direction getDirectionTowards(const Actor *target);
+  bool followField(const FlowField &field, Direction &dir) const;
 
   double nextX(const Direction &dir) const {
     switch (dir) {
@@ -97,7 +129,7 @@ public:
 
 private:
   double m_speed;
-  bool m_isParalyzed;
+  bool m_isParalyzed = false;
 };
 
 class Human : public Agent {
@@ -109,7 +141,6 @@ public:
     if (!turnFinished())
       updateInfection();
   }
-  virtual bool isHuman() const { return true; }
   virtual void infect() {
     if (!isInfected())
       m_infectedTime = 0; // start counting
@@ -174,7 +205,6 @@ public:
   bool vomit();
   virtual void doSomething();
   virtual void die();
-  virtual bool isZombie() const { return true; }
   int getPlan() const { return m_plan; }
   void setPlan(const int &plan) { m_plan = plan; }
   void decPlan() { m_plan--; }
@@ -195,12 +225,15 @@ public:
   SmartZombie(StudentWorld *world, double x, double y) : Zombie(world, x, y) {}
   virtual void doSomething();
   virtual void die();
+
+private:
+  bool m_isChasing = false; // someone was in sight at the last plan
 };
 
 class Goodie : public Actor {
 public:
   Goodie(StudentWorld *world, int imageID, double x, double y)
-      : Actor(world, imageID, x, y, right, 1) {}
+      : Actor(world, imageID, x, y, right, 1, ACTOR_GOODIE) {}
   virtual void doSomething();
   virtual void die() { scheduleRemoval(); }
 };
@@ -230,7 +263,7 @@ class Projectile : public Actor {
 public:
   Projectile(StudentWorld *world, int imageID, double x, double y,
              const Direction &dir)
-      : Actor(world, imageID, x, y, dir, 0) {}
+      : Actor(world, imageID, x, y, dir, 0, ACTOR_PROJECTILE) {}
   virtual void doSomething();
 
 private:
@@ -270,7 +303,7 @@ private:
 class Pit : public Actor {
 public:
   Pit(StudentWorld *world, double x, double y)
-      : Actor(world, IID_PIT, x, y, right, 0) {}
+      : Actor(world, IID_PIT, x, y, right, 0, ACTOR_HAZARD) {}
   virtual void doSomething();
   virtual void scheduleRemoval() {}
 };
@@ -278,9 +311,8 @@ public:
 class Exit : public Actor {
 public:
   Exit(StudentWorld *world, double x, double y)
-      : Actor(world, IID_EXIT, x, y, right, 1) {}
+      : Actor(world, IID_EXIT, x, y, right, 1, ACTOR_EXIT) {}
   virtual void doSomething();
-  virtual bool isFlammable() const { return false; }
   virtual void scheduleRemoval() {}
 };
 
@@ -0,0 +1,113 @@
+#ifndef ACTORSTORE_H_
+#define ACTORSTORE_H_
+
+#include <cstddef>
+#include <vector>
+
+class Actor;
+
+using namespace std;
+
+// What an actor is, as far as the world's queries are concerned; the world
+// keeps the actors of each kind apart, so a query only looks at the kinds it
+// is about.
+enum ActorKind {
+  ACTOR_WALL,
+  ACTOR_EXIT,
+  ACTOR_HUMAN,
+  ACTOR_ZOMBIE,
+  ACTOR_GOODIE,
+  ACTOR_PROJECTILE,
+  ACTOR_HAZARD, // pits and landmines
+  N_ACTOR_KINDS
+};
+
+// Refers to an actor in an ActorStore. A handle stays good however the store
+// is rearranged, and once its actor is gone it refers to nothing rather than
+// to whoever took its place.
+struct ActorHandle {
+  int slot = -1;
+  int generation = 0;
+};
+
+// The actors of a level, packed in one vector in the order they were added,
+// so that a tick walks through them front to back. Dead actors are taken out
+// in one pass at the end of the tick, which keeps the rest in order and the
+// pointers and handles handed out during the tick good until then.
+class ActorStore {
+public:
+  ActorHandle add(Actor *actor) {
+    ActorHandle handle;
+    if (m_freeSlots.empty()) {
+      handle.slot = static_cast<int>(m_slots.size());
+      m_slots.emplace_back();
+    } else {
+      handle.slot = m_freeSlots.back();
+      m_freeSlots.pop_back();
+    }
+    Slot &slot = m_slots[handle.slot];
+    slot.actor = actor;
+    handle.generation = slot.generation;
+    m_actors.push_back(actor);
+    m_slotOf.push_back(handle.slot);
+    return handle;
+  }
+  // the actor, or nullptr if it has been taken out
+  Actor *get(const ActorHandle &handle) const {
+    if (handle.slot < 0 || handle.slot >= static_cast<int>(m_slots.size()))
+      return nullptr;
+    Slot const &slot = m_slots[handle.slot];
+    return slot.generation == handle.generation ? slot.actor : nullptr;
+  }
+  // Take out the actors isDead(actor) says should go, appending them to dead
+  // for the caller to dispose of.
+  template <typename IsDead>
+  void collect(IsDead isDead, vector<Actor *> &dead) {
+    size_t kept = 0;
+    for (size_t i = 0; i < m_actors.size(); i++) {
+      Slot &slot = m_slots[m_slotOf[i]];
+      if (isDead(m_actors[i])) {
+        dead.push_back(m_actors[i]);
+        slot.actor = nullptr;
+        slot.generation++;
+        m_freeSlots.push_back(m_slotOf[i]);
+      } else {
+        m_actors[kept] = m_actors[i];
+        m_slotOf[kept] = m_slotOf[i];
+        kept++;
+      }
+    }
+    m_actors.resize(kept);
+    m_slotOf.resize(kept);
+  }
+  // forget every actor, deleting them is up to the caller; the slots are
+  // kept, so that old handles cannot refer to the actors added next
+  void clear() {
+    m_actors.clear();
+    m_slotOf.clear();
+    m_freeSlots.clear();
+    for (size_t i = 0; i < m_slots.size(); i++) {
+      if (m_slots[i].actor != nullptr)
+        m_slots[i].generation++;
+      m_slots[i].actor = nullptr;
+      m_freeSlots.push_back(static_cast<int>(i));
+    }
+  }
+
+  size_t size() const { return m_actors.size(); }
+  Actor *operator[](const size_t &i) const { return m_actors[i]; }
+  vector<Actor *>::const_iterator begin() const { return m_actors.begin(); }
+  vector<Actor *>::const_iterator end() const { return m_actors.end(); }
+
+private:
+  struct Slot {
+    Actor *actor = nullptr;
+    int generation = 0;
+  };
+  vector<Actor *> m_actors; // in the order they were added
+  vector<int> m_slotOf;     // the slot of each of m_actors
+  vector<Slot> m_slots;
+  vector<int> m_freeSlots;
+};
+
+#endif // ACTORSTORE_H_
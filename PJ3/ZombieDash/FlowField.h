@@ -0,0 +1,115 @@
+#ifndef FLOWFIELD_H_
+#define FLOWFIELD_H_
+
+#include "GameConstants.h"
+
+#include <algorithm>
+#include <vector>
+
+using namespace std;
+
+// For every SPRITE_WIDTH x SPRITE_HEIGHT cell of the level, how many steps
+// from cell to cell, around the walls, it is to the nearest of a set of
+// sources, and which cell is the next one on the way there. One
+// breadth-first sweep of the level finds the way from everywhere at once, so
+// any number of agents can then look up their way for nothing. The sweep is
+// only done again once a source has moved to another cell, or the walls
+// have changed.
+class FlowField {
+public:
+  enum { UNREACHABLE = -1 };
+
+  FlowField()
+      : m_isWall(N_CELLS, false), m_steps(N_CELLS, UNREACHABLE),
+        m_next(N_CELLS, -1) {
+    m_queue.reserve(N_CELLS);
+  }
+
+  void addWall(const int &x, const int &y) {
+    m_isWall[cellAt(x, y)] = true;
+    m_isStale = true;
+  }
+  void clearWalls() {
+    fill(m_isWall.begin(), m_isWall.end(), false);
+    m_isStale = true;
+  }
+
+  // start over with no sources; add them, then build the field
+  void clearSources() { m_sources.clear(); }
+  void addSource(const int &x, const int &y) {
+    m_sources.push_back(cellAt(x, y));
+  }
+  void build() {
+    if (!m_isStale && m_sources == m_builtFrom)
+      return;
+    m_isStale = false;
+    m_builtFrom = m_sources;
+    fill(m_steps.begin(), m_steps.end(), static_cast<int>(UNREACHABLE));
+    fill(m_next.begin(), m_next.end(), -1);
+    m_queue.clear();
+    for (int cell : m_sources) {
+      if (m_steps[cell] != 0) {
+        m_steps[cell] = 0;
+        m_queue.push_back(cell);
+      }
+    }
+    // right, up, left, down
+    static const int dCol[] = {1, 0, -1, 0}, dRow[] = {0, 1, 0, -1};
+    for (size_t i = 0; i < m_queue.size(); i++) {
+      int const cell = m_queue[i];
+      int const col = cell % LEVEL_WIDTH, row = cell / LEVEL_WIDTH;
+      for (int k = 0; k < 4; k++) {
+        int const c = col + dCol[k], r = row + dRow[k];
+        if (c < 0 || c >= LEVEL_WIDTH || r < 0 || r >= LEVEL_HEIGHT)
+          continue;
+        int const next = r * LEVEL_WIDTH + c;
+        if (m_isWall[next] || m_steps[next] != UNREACHABLE)
+          continue;
+        m_steps[next] = m_steps[cell] + 1;
+        m_next[next] = cell;
+        m_queue.push_back(next);
+      }
+    }
+  }
+
+  // steps from the cell of (x, y) to the nearest source, or UNREACHABLE
+  int steps(const int &x, const int &y) const { return m_steps[cellAt(x, y)]; }
+  // The corner of the next cell on the way from the cell of (x, y) to the
+  // nearest source. False if (x, y) is in a source's cell already, or if no
+  // way leads from it to one.
+  bool next(const int &x, const int &y, int &nextX, int &nextY) const {
+    int const cell = m_next[cellAt(x, y)];
+    if (cell < 0)
+      return false;
+    nextX = cell % LEVEL_WIDTH * SPRITE_WIDTH;
+    nextY = cell / LEVEL_WIDTH * SPRITE_HEIGHT;
+    return true;
+  }
+
+  // the corner of the cell (x, y) is in
+  static int cellX(const int &x) { return column(x) * SPRITE_WIDTH; }
+  static int cellY(const int &y) { return row(y) * SPRITE_HEIGHT; }
+
+private:
+  static const int N_CELLS = LEVEL_WIDTH * LEVEL_HEIGHT;
+
+  static int column(const int &x) {
+    return min(max(x, 0) / SPRITE_WIDTH, LEVEL_WIDTH - 1);
+  }
+  static int row(const int &y) {
+    return min(max(y, 0) / SPRITE_HEIGHT, LEVEL_HEIGHT - 1);
+  }
+  static int cellAt(const int &x, const int &y) {
+    return row(y) * LEVEL_WIDTH + column(x);
+  }
+
+  vector<char> m_isWall;
+  vector<int> m_steps;
+  vector<int> m_next;      // the next cell on the way, or -1
+  vector<int> m_queue;     // the cells the sweep has reached, in order
+  vector<int> m_sources;   // the cells of the sources added
+  vector<int> m_builtFrom; // the sources of the last sweep
+  bool m_isStale = true;   // the walls changed since the last sweep
+};
+
+#endif // FLOWFIELD_H_
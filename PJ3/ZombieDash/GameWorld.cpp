@@ -1,11 +1,34 @@
 #include "GameWorld.h"
-#include "GameController.h"
 #include <string>
 #include <cstdlib>
 using namespace std;
 
+#ifdef HEADLESS
+
+  // No GameController (nor GLUT and OpenGL) in a headless build
+
+bool GameWorld::getKey(int& value)
+{
+    return m_keySource  &&  m_keySource(value);
+}
+
+void GameWorld::playSound(int)
+{
+}
+
+void GameWorld::setGameStatText(string)
+{
+}
+
+#else
+
+#include "GameController.h"
+
 bool GameWorld::getKey(int& value)
 {
+    if (m_controller == nullptr)
+        return m_keySource  &&  m_keySource(value);
+
     bool gotKey = m_controller->getLastKey(value);
 
     if (gotKey)
@@ -18,10 +41,14 @@ bool GameWorld::getKey(int& value)
 
 void GameWorld::playSound(int soundID)
 {
-    m_controller->playSound(soundID);
+    if (m_controller != nullptr)
+        m_controller->playSound(soundID);
 }
 
 void GameWorld::setGameStatText(string text)
 {
-    m_controller->setGameStatText(text);
+    if (m_controller != nullptr)
+        m_controller->setGameStatText(text);
 }
+
+#endif // HEADLESS
@@ -2,6 +2,7 @@
 #define GAMEWORLD_H_
 
 #include "GameConstants.h"
+#include <functional>
 #include <string>
 
 const int START_PLAYER_LIVES = 3;
@@ -82,6 +83,16 @@ public:
     {
         m_controller = controller;
     }
+
+      // Without a controller, as in a headless run, getKey() asks the key
+      // source instead, and sounds and stat text go nowhere.  The key source
+      // returns false when no key was hit.
+    using KeySource = std::function<bool(int&)>;
+
+    void setKeySource(KeySource keySource)
+    {
+        m_keySource = keySource;
+    }
     
 private:
     int m_lives;
@@ -89,6 +100,7 @@ private:
     int m_level;
     GameController* m_controller;
     std::string     m_assetPath;
+    KeySource       m_keySource;
 };
 
 #endif // GAMEWORLD_H_
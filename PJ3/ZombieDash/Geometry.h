@@ -0,0 +1,43 @@
+#ifndef GEOMETRY_H_
+#define GEOMETRY_H_
+
+#include <cmath>
+#include <cstdlib>
+
+using namespace std;
+
+// Every position in the game is a whole number of pixels: the levels are laid
+// out in sprites, and everything moves and fires by whole pixels. So
+// distances can be compared squared, in ints, with no square roots.
+// Distances are rounded down, as they always have been, which makes
+// "at most dist away" the same as "squared distance below (dist + 1)^2".
+
+inline int distSquared(const int &x1, const int &y1, const int &x2,
+                       const int &y2) {
+  int const dx = x1 - x2;
+  int const dy = y1 - y2;
+  return dx * dx + dy * dy;
+}
+
+// the smallest squared distance that is more than dist away
+inline int beyondSquared(const int &dist) { return (dist + 1) * (dist + 1); }
+
+// the distance, rounded down, for a squared distance
+inline int distFromSquared(const int &distSquared) {
+  return static_cast<int>(sqrt(static_cast<double>(distSquared)));
+}
+
+inline bool withinDist(const int &x1, const int &y1, const int &x2,
+                       const int &y2, const int &dist) {
+  return distSquared(x1, y1, x2, y2) < beyondSquared(dist);
+}
+
+// whether (x2, y2) is at most halfWidth and halfHeight from (x1, y1) along
+// the two axes
+inline bool withinSquare(const int &x1, const int &y1, const int &x2,
+                         const int &y2, const int &halfWidth,
+                         const int &halfHeight) {
+  return abs(x1 - x2) <= halfWidth && abs(y1 - y2) <= halfHeight;
+}
+
+#endif // GEOMETRY_H_
@@ -1,7 +1,9 @@
 #ifndef GRAPHOBJ_H_
 #define GRAPHOBJ_H_
 
+#ifndef HEADLESS
 #include "SpriteManager.h"
+#endif
 #include "GameConstants.h"
 
 #include <set>
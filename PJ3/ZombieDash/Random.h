@@ -0,0 +1,65 @@
+#ifndef RANDOM_H_
+#define RANDOM_H_
+
+#include <cstdint>
+
+using namespace std;
+
+// xoshiro256** (Blackman and Vigna), seeded through splitmix64. Its whole
+// state is four words, so every actor can have a stream of its own, and the
+// numbers it makes depend on nothing but the seed: the same seed plays out
+// the same game on any machine and with any standard library.
+class Rng {
+public:
+  explicit Rng(const uint64_t &seed = 0) { reseed(seed); }
+
+  void reseed(uint64_t seed) {
+    for (auto &word : m_state) {
+      // splitmix64, to spread the seed over the state
+      seed += 0x9e3779b97f4a7c15;
+      uint64_t z = seed;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+      word = z ^ (z >> 31);
+    }
+  }
+  uint64_t next() {
+    uint64_t const result = rotl(m_state[1] * 5, 7) * 9;
+    uint64_t const t = m_state[1] << 17;
+    m_state[2] ^= m_state[0];
+    m_state[3] ^= m_state[1];
+    m_state[1] ^= m_state[2];
+    m_state[0] ^= m_state[3];
+    m_state[2] ^= t;
+    m_state[3] = rotl(m_state[3], 45);
+    return result;
+  }
+  // a new stream, seeded from this one
+  Rng split() { return Rng(next()); }
+
+  // uniformly distributed in [min, max]
+  int uniformInt(const int &min, const int &max) {
+    uint64_t const range = static_cast<uint64_t>(max) - min + 1;
+    // the rejection keeps every value equally likely
+    uint64_t const limit = -range % range;
+    uint64_t r;
+    do
+      r = next();
+    while (r < limit);
+    return min + static_cast<int>(r % range);
+  }
+  // true with probability p
+  bool bernoulli(const double &p) {
+    // the top 53 bits, as a double in [0, 1)
+    return (next() >> 11) * (1.0 / (uint64_t(1) << 53)) < p;
+  }
+
+private:
+  static uint64_t rotl(const uint64_t &x, const int &k) {
+    return (x << k) | (x >> (64 - k));
+  }
+
+  uint64_t m_state[4];
+};
+
+#endif // RANDOM_H_
@@ -0,0 +1,186 @@
+#ifndef SPATIALGRID_H_
+#define SPATIALGRID_H_
+
+#include "GameConstants.h"
+#include "Geometry.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+class Actor;
+
+using namespace std;
+
+// Buckets actors by the SPRITE_WIDTH x SPRITE_HEIGHT cell their position is
+// in, so that a query only has to look at the few cells around a point
+// instead of at every actor in the level. Positions outside of the level are
+// kept in the nearest cell on the edge.
+//
+// Each cell keeps its actors' positions next to them, as arrays of xs and
+// ys, so the distance tests of a query run over plain ints in batches the
+// compiler can vectorize, and only the actors that pass are looked at.
+class SpatialGrid {
+public:
+  SpatialGrid() : m_cells(LEVEL_WIDTH * LEVEL_HEIGHT) {}
+
+  void insert(Actor *actor, const int &x, const int &y) {
+    Cell &cell = m_cells[cellAt(x, y)];
+    cell.actors.push_back(actor);
+    cell.xs.push_back(x);
+    cell.ys.push_back(y);
+  }
+  void remove(Actor *actor, const int &x, const int &y) {
+    Cell &cell = m_cells[cellAt(x, y)];
+    size_t const i = cell.find(actor);
+    if (i == cell.actors.size())
+      return;
+    cell.actors[i] = cell.actors.back();
+    cell.xs[i] = cell.xs.back();
+    cell.ys[i] = cell.ys.back();
+    cell.actors.pop_back();
+    cell.xs.pop_back();
+    cell.ys.pop_back();
+  }
+  // the actor has moved from (oldX, oldY) to (newX, newY)
+  void move(Actor *actor, const int &oldX, const int &oldY, const int &newX,
+            const int &newY) {
+    if (cellAt(oldX, oldY) != cellAt(newX, newY)) {
+      remove(actor, oldX, oldY);
+      insert(actor, newX, newY);
+      return;
+    }
+    Cell &cell = m_cells[cellAt(newX, newY)];
+    size_t const i = cell.find(actor);
+    if (i != cell.actors.size()) {
+      cell.xs[i] = newX;
+      cell.ys[i] = newY;
+    }
+  }
+  void clear() {
+    for (auto &cell : m_cells) {
+      cell.actors.clear();
+      cell.xs.clear();
+      cell.ys.clear();
+    }
+  }
+
+  // Call visit(actor, actorX, actorY) for every actor in the grid.
+  template <typename Visit>
+  void forEach(Visit visit) const {
+    for (const Cell &cell : m_cells)
+      for (size_t i = 0; i < cell.actors.size(); i++)
+        visit(cell.actors[i], cell.xs[i], cell.ys[i]);
+  }
+
+  // Call visit(actor) for every actor at most dist away from (x, y), as
+  // withinDist has it. Stops as soon as visit returns true, and returns
+  // whether it did.
+  template <typename Visit>
+  bool anyWithin(const int &x, const int &y, const int &dist,
+                 Visit visit) const {
+    int const limit = beyondSquared(dist);
+    return anyMatching(x, y, dist, visit, [&](const int &dx, const int &dy) {
+      return dx * dx + dy * dy < limit;
+    });
+  }
+  // Call visit(actor) for every actor at most halfWidth and halfHeight away
+  // from (x, y) along the two axes, as withinSquare has it. Stops as soon as
+  // visit returns true, and returns whether it did.
+  template <typename Visit>
+  bool anyInSquare(const int &x, const int &y, const int &halfWidth,
+                   const int &halfHeight, Visit visit) const {
+    return anyMatching(x, y, max(halfWidth, halfHeight), visit,
+                       [&](const int &dx, const int &dy) {
+                         return (dx >= -halfWidth) & (dx <= halfWidth) &
+                                (dy >= -halfHeight) & (dy <= halfHeight);
+                       });
+  }
+
+  // Call visit(actor, actorX, actorY) for every actor in the cells exactly r
+  // cells away from the cell of (x, y), that is, on the border of the
+  // (2r + 1) x (2r + 1) square of cells around it. Walking the rings
+  // outwards from 0 visits every actor, nearest cells first.
+  template <typename Visit>
+  void forEachInRing(const int &x, const int &y, const int &r,
+                     Visit visit) const {
+    int const col0 = column(x), row0 = row(y);
+    auto visitCell = [&](const int &rw, const int &c) {
+      if (rw < 0 || rw >= LEVEL_HEIGHT || c < 0 || c >= LEVEL_WIDTH)
+        return;
+      const Cell &cell = m_cells[rw * LEVEL_WIDTH + c];
+      for (size_t i = 0; i < cell.actors.size(); i++)
+        visit(cell.actors[i], cell.xs[i], cell.ys[i]);
+    };
+    if (r == 0) {
+      visitCell(row0, col0);
+      return;
+    }
+    for (int c = col0 - r; c <= col0 + r; c++) {
+      visitCell(row0 - r, c);
+      visitCell(row0 + r, c);
+    }
+    for (int rw = row0 - r + 1; rw < row0 + r; rw++) {
+      visitCell(rw, col0 - r);
+      visitCell(rw, col0 + r);
+    }
+  }
+  // no actor in ring r or beyond is closer than this to the query point
+  static int ringDistance(const int &r) {
+    return max(r - 1, 0) * min(SPRITE_WIDTH, SPRITE_HEIGHT);
+  }
+  // every cell is within this many rings of any other
+  static int ringCount() { return max(LEVEL_WIDTH, LEVEL_HEIGHT); }
+
+private:
+  struct Cell {
+    vector<Actor *> actors;
+    vector<int> xs, ys; // where each of the actors is
+    size_t find(const Actor *actor) const {
+      return std::find(actors.begin(), actors.end(), actor) - actors.begin();
+    }
+  };
+  enum { BATCH = 16 }; // positions tested at a time
+
+  // Calls visit on the actors, in the cells within reach of (x, y), whose
+  // offset (dx, dy) from it passes test. The tests of a batch are done
+  // before any actor is visited, so they are one straight loop over the
+  // arrays; test should be branch free to keep it so.
+  template <typename Visit, typename Test>
+  bool anyMatching(const int &x, const int &y, const int &reach, Visit &visit,
+                   Test test) const {
+    int const col1 = column(x - reach), col2 = column(x + reach);
+    int const row1 = row(y - reach), row2 = row(y + reach);
+    bool passed[BATCH];
+    for (int r = row1; r <= row2; r++) {
+      for (int c = col1; c <= col2; c++) {
+        const Cell &cell = m_cells[r * LEVEL_WIDTH + c];
+        size_t const n = cell.actors.size();
+        const int *xs = cell.xs.data(), *ys = cell.ys.data();
+        for (size_t first = 0; first < n; first += BATCH) {
+          size_t const count = min<size_t>(BATCH, n - first);
+          for (size_t i = 0; i < count; i++)
+            passed[i] = test(xs[first + i] - x, ys[first + i] - y);
+          for (size_t i = 0; i < count; i++)
+            if (passed[i] && visit(cell.actors[first + i]))
+              return true;
+        }
+      }
+    }
+    return false;
+  }
+
+  static int column(const int &x) {
+    return min(max(x, 0) / SPRITE_WIDTH, LEVEL_WIDTH - 1);
+  }
+  static int row(const int &y) {
+    return min(max(y, 0) / SPRITE_HEIGHT, LEVEL_HEIGHT - 1);
+  }
+  static int cellAt(const int &x, const int &y) {
+    return row(y) * LEVEL_WIDTH + column(x);
+  }
+
+  vector<Cell> m_cells;
+};
+
+#endif // SPATIALGRID_H_
@@ -1,14 +1,16 @@
 #include "GameConstants.h"
+#include "Geometry.h"
 #include "Level.h"
 
 #include "Actor.h"
 #include "StudentWorld.h"
 
-#include <cmath>
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 #include <random>
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -16,11 +18,14 @@ GameWorld *createStudentWorld(string assetPath) {
   return new StudentWorld(assetPath);
 }
 
-StudentWorld::StudentWorld(string assetPath) : GameWorld(assetPath) {}
+// unless told otherwise, every game is different
+StudentWorld::StudentWorld(string assetPath)
+    : GameWorld(assetPath), m_random(random_device()()) {}
 
 int StudentWorld::init() {
   // reset everything
   m_levelFinished = false;
+  m_playerDied = false;
   m_nCitizen = 0;
   // load level file according to getLevel()
   Level level(assetPath());
@@ -92,6 +97,10 @@ int StudentWorld::init() {
 }
 
 int StudentWorld::move() {
+  if (playerDied()) {
+    decLives();
+    return GWSTATUS_PLAYER_DIED;
+  }
   setGameStatText("Score: " + to_string(getScore()) + "  " +
                   "Level: " + to_string(getLevel()) + "  " +
                   "Lives: " + to_string(getLives()) + "  " +
@@ -99,19 +108,22 @@ int StudentWorld::move() {
                   "Flames: " + to_string(player()->gasCanCount()) + "  " +
                   "Mines:  " + to_string(player()->landmineCount()) + "  " +
                   "Infected: " + to_string(player()->infectionTime()));
-  if (playerDied()) {
-    decLives();
-    return GWSTATUS_PLAYER_DIED;
-  }
-  for (auto actor : m_actors)
-    actor->doSomething();
+  updateFields();
+  // actors added during the tick get their turn in it too
+  for (size_t i = 0; i < m_actors.size(); i++)
+    m_actors[i]->doSomething();
   // remove dead actors (R.I.P.)
-  m_actors.remove_if([this](Actor *a) {
-    bool shouldRemove = a->willBeRemoved();
-    if (shouldRemove)
-      delete a;
-    return shouldRemove;
-  });
+  m_actors.collect([](Actor *a) { return a->willBeRemoved(); }, m_dead);
+  for (auto actor : m_dead) {
+    if (actor == player()) {
+      // the next tick reports her death
+      m_playerDied = true;
+      setPlayer(nullptr);
+    }
+    unindexActor(actor);
+    delete actor;
+  }
+  m_dead.clear();
 
   return levelFinished() ? GWSTATUS_FINISHED_LEVEL : GWSTATUS_CONTINUE_GAME;
 }
@@ -120,6 +132,46 @@ void StudentWorld::cleanUp() {
   for (auto actor : m_actors)
     delete actor;
   m_actors.clear();
+  for (auto &partition : m_partitions)
+    partition.clear();
+  m_wallBitmap.clear();
+  m_towardPenelope.clearWalls();
+  m_towardHumans.clearWalls();
+  m_nSpawned = 0;
+}
+
+void StudentWorld::addActor(Actor *actor) {
+  actor->setSpawnOrder(m_nSpawned++);
+  actor->setRandom(m_random.split());
+  actor->setHandle(m_actors.add(actor));
+  indexActor(actor);
+}
+
+void StudentWorld::actorMoved(Actor *actor, const int &oldX,
+                              const int &oldY) {
+  m_partitions[actor->kind()].move(actor, oldX, oldY, actor->getX(),
+                                   actor->getY());
+}
+
+// one sweep of the level each, however many agents there are to use them
+void StudentWorld::updateFields() {
+  m_towardPenelope.clearSources();
+  m_towardPenelope.addSource(player()->getX(), player()->getY());
+  m_towardPenelope.build();
+  m_towardHumans.clearSources();
+  m_partitions[ACTOR_HUMAN].forEach(
+      [this](Actor *, const int &x, const int &y) {
+        m_towardHumans.addSource(x, y);
+      });
+  m_towardHumans.build();
+}
+
+void StudentWorld::indexActor(Actor *actor) {
+  m_partitions[actor->kind()].insert(actor, actor->getX(), actor->getY());
+}
+
+void StudentWorld::unindexActor(Actor *actor) {
+  m_partitions[actor->kind()].remove(actor, actor->getX(), actor->getY());
 }
 
 // Actor Adders
@@ -167,6 +219,9 @@ bool StudentWorld::addExit(const double &x, const double &y) {
 
 bool StudentWorld::addWall(const double &x, const double &y) {
   addActor(new Wall(this, x, y));
+  m_wallBitmap.addWall(x, y);
+  m_towardPenelope.addWall(x, y);
+  m_towardHumans.addWall(x, y);
   return true;
 }
 
@@ -195,15 +250,13 @@ bool StudentWorld::addVomit(const double &x, const double &y,
 }
 
 // Helpers
-int StudentWorld::distBetween(const double &x1, const double &y1,
-                              const double &x2, const double &y2) const {
-  double dx = x1 - x2;
-  double dy = y1 - y2;
-  return sqrt(dx * dx + dy * dy);
+int StudentWorld::distBetween(const int &x1, const int &y1, const int &x2,
+                              const int &y2) const {
+  return distFromSquared(distSquared(x1, y1, x2, y2));
 }
 
-int StudentWorld::distBetween(const Actor *obj, const double &x,
-                              const double &y) const {
+int StudentWorld::distBetween(const Actor *obj, const int &x,
+                              const int &y) const {
   return distBetween(obj->getX(), obj->getY(), x, y);
 }
 
@@ -211,13 +264,13 @@ int StudentWorld::distBetween(const Actor *obj1, const Actor *obj2) const {
   return distBetween(obj1, obj2->getX(), obj2->getY());
 }
 
-bool StudentWorld::checkOverlap(const double &x1, const double &y1,
-                                const double &x2, const double &y2) const {
-  return distBetween(x1, y1, x2, y2) <= OVERLAP_DISTANCE;
+bool StudentWorld::checkOverlap(const int &x1, const int &y1, const int &x2,
+                                const int &y2) const {
+  return withinDist(x1, y1, x2, y2, OVERLAP_DISTANCE);
 }
 
-bool StudentWorld::checkOverlap(const Actor *obj, const double &x,
-                                const double &y) const {
+bool StudentWorld::checkOverlap(const Actor *obj, const int &x,
+                                const int &y) const {
   return checkOverlap(obj->getX(), obj->getY(), x, y);
 }
 
@@ -225,147 +278,155 @@ bool StudentWorld::checkOverlap(const Actor *obj1, const Actor *obj2) const {
   return checkOverlap(obj1, obj2->getX(), obj2->getY());
 }
 
-bool StudentWorld::checkFlammableAt(const double &x, const double &y) const {
-  for (auto actor : m_actors) {
-    if (!actor->isFlammable() && checkOverlap(actor, x, y))
-      return false;
-  }
-  return true;
+bool StudentWorld::checkNear(const Actor *obj1, const Actor *obj2) const {
+  return withinDist(obj1->getX(), obj1->getY(), obj2->getX(), obj2->getY(),
+                    NEAR_DISTANCE);
+}
+
+bool StudentWorld::checkFlammableAt(const int &x, const int &y) const {
+  return !anyOverlapping({ACTOR_WALL, ACTOR_EXIT}, x, y,
+                         [](Actor *) { return true; });
 }
 
 bool StudentWorld::checkBlockAtDir(const Actor *obj, const Direction &dir,
-                                   const double &dist) const {
-  int x1, y1, x2, y2;
-  x1 = obj->getX();
-  y1 = obj->getY();
+                                   const int &dist) const {
+  int x = obj->getX();
+  int y = obj->getY();
   if (dir == RIGHT)
-    x1 += dist;
+    x += dist;
   if (dir == UP)
-    y1 += dist;
+    y += dist;
   if (dir == LEFT)
-    x1 -= dist;
+    x -= dist;
   if (dir == DOWN)
-    y1 -= dist;
-  for (auto actor : m_actors) {
-    if (actor == obj || !actor->blocks())
-      continue;
-    x2 = actor->getX();
-    y2 = actor->getY();
-    if (squareOverlap(x1, y1, x2, y2, SPRITE_WIDTH - 1, SPRITE_HEIGHT - 1))
+    y -= dist;
+  // walls do not move, so only the agents have to be looked for
+  if (m_wallBitmap.blocks(x, y))
+    return true;
+  auto blocked = [&](Actor *actor) { return actor != obj; };
+  for (ActorKind kind : {ACTOR_HUMAN, ACTOR_ZOMBIE})
+    if (m_partitions[kind].anyInSquare(x, y, SPRITE_WIDTH - 1,
+                                       SPRITE_HEIGHT - 1, blocked))
       return true;
-  }
   return false;
 }
 
-bool StudentWorld::checkOverlapWithHuman(const double &x,
-                                         const double &y) const {
-
-  for (auto actor : m_actors) {
-    if (actor->isHuman() && checkOverlap(actor, x, y)) {
-      return true;
-    }
-  }
-  return false;
+bool StudentWorld::checkOverlapWithHuman(const int &x, const int &y) const {
+  return anyOverlapping({ACTOR_HUMAN}, x, y, [](Actor *) { return true; });
 }
 
-bool StudentWorld::checkOverlapWithAgent(const double &x,
-                                         const double &y) const {
-  for (auto actor : m_actors) {
-    if ((actor->isHuman() || actor->isZombie()) && checkOverlap(actor, x, y))
-      return true;
-  }
-  return false;
+bool StudentWorld::checkOverlapWithAgent(const int &x, const int &y) const {
+  return anyOverlapping({ACTOR_HUMAN, ACTOR_ZOMBIE}, x, y,
+                        [](Actor *) { return true; });
 }
 
-bool StudentWorld::squareOverlap(const double &x1, const double &y1,
-                                 const double &x2, const double &y2,
-                                 const double &width,
-                                 const double &height) const {
-  if (x2 >= x1 - width && x2 <= x1 + width && y2 >= y1 - height &&
-      y2 <= y1 + height) {
-    return true;
-  }
-  if (y2 >= y1 - height && y2 <= y1 + height && x2 >= x1 - width &&
-      x2 <= x1 + width) {
-    return true;
-  }
-  return false;
+bool StudentWorld::squareOverlap(const int &x1, const int &y1, const int &x2,
+                                 const int &y2, const int &width,
+                                 const int &height) const {
+  return withinSquare(x1, y1, x2, y2, width, height);
 }
 
-bool StudentWorld::squareOverlap(const Actor *obj1, const double &x2,
-                                 const double &y2, const double &width,
-                                 const double &height) const {
+bool StudentWorld::squareOverlap(const Actor *obj1, const int &x2,
+                                 const int &y2, const int &width,
+                                 const int &height) const {
   return squareOverlap(obj1->getX(), obj1->getY(), x2, y2, width, height);
 }
 
 bool StudentWorld::squareOverlap(const Actor *obj1, const Actor *obj2,
-                                 const double &width,
-                                 const double &height) const {
+                                 const int &width, const int &height) const {
   return squareOverlap(obj1, obj2->getX(), obj2->getY(), width, height);
 }
 
-void StudentWorld::infectAt(const double &x, const double &y) {
-  for (auto actor : m_actors) {
-    if (!actor->willBeRemoved() && checkOverlap(actor, x, y))
-      actor->infect();
-  }
+template <typename Visit>
+bool StudentWorld::anyOverlapping(initializer_list<ActorKind> kinds,
+                                  const int &x, const int &y,
+                                  Visit visit) const {
+  for (ActorKind kind : kinds)
+    if (m_partitions[kind].anyWithin(x, y, OVERLAP_DISTANCE, visit))
+      return true;
+  return false;
 }
 
-void StudentWorld::evacuateAt(const double &x, const double &y) {
-  for (auto actor : m_actors) {
-    if (!actor->willBeRemoved() && checkOverlap(actor, x, y))
-      actor->evacuate();
+template <typename Act>
+void StudentWorld::forEachOverlapping(initializer_list<ActorKind> kinds,
+                                      const int &x, const int &y, Act act) {
+  // Acting may add actors (a landmine blowing up, a zombie dropping a
+  // vaccine), and those are acted on too if they overlap, after everyone
+  // who was there before them, just like walking m_actors in order would.
+  vector<Actor *> overlapping;
+  for (long from = 0; from < m_nSpawned;) {
+    long const to = m_nSpawned;
+    overlapping.clear();
+    anyOverlapping(kinds, x, y, [&](Actor *actor) {
+      if (actor->spawnOrder() >= from)
+        overlapping.push_back(actor);
+      return false;
+    });
+    sort(overlapping.begin(), overlapping.end(), [](Actor *a, Actor *b) {
+      return a->spawnOrder() < b->spawnOrder();
+    });
+    for (auto actor : overlapping)
+      if (!actor->willBeRemoved())
+        act(actor);
+    from = to;
   }
 }
 
-void StudentWorld::killAt(const double &x, const double &y) {
-  for (auto actor : m_actors) {
-    if (!actor->willBeRemoved() && checkOverlap(actor, x, y))
-      // Knock-knock-knockin' on heaven's door
-      actor->die();
-  }
+// only humans can be infected or evacuated, and walls, exits, pits and
+// projectiles cannot die
+
+void StudentWorld::infectAt(const int &x, const int &y) {
+  forEachOverlapping({ACTOR_HUMAN}, x, y,
+                     [](Actor *actor) { actor->infect(); });
 }
 
-Actor *StudentWorld::getNearestZombie(const double &x, const double &y) const {
-  double minDist = sqrt(VIEW_WIDTH * VIEW_WIDTH + VIEW_HEIGHT * VIEW_HEIGHT);
-  double currDist;
-  Actor *nearestZombie = nullptr;
-  for (auto actor : m_actors) {
-    if (!actor->isZombie())
-      continue;
-    currDist = distBetween(actor, x, y);
-    if (currDist < minDist) {
-      minDist = currDist;
-      nearestZombie = actor;
-    }
-  }
-  return nearestZombie;
-}
-
-Actor *StudentWorld::getNearestHuman(const double &x, const double &y) const {
-  double minDist = sqrt(VIEW_WIDTH * VIEW_WIDTH + VIEW_HEIGHT * VIEW_HEIGHT);
-  double currDist;
-  Actor *nearestHuman = nullptr;
-  for (auto actor : m_actors) {
-    if (!actor->isHuman())
-      continue;
-    currDist = distBetween(actor, x, y);
-    if (currDist < minDist) {
-      minDist = currDist;
-      nearestHuman = actor;
-    }
-  }
-  return nearestHuman;
+void StudentWorld::evacuateAt(const int &x, const int &y) {
+  forEachOverlapping({ACTOR_HUMAN}, x, y,
+                     [](Actor *actor) { actor->evacuate(); });
+}
+
+void StudentWorld::killAt(const int &x, const int &y) {
+  auto kill = [](Actor *actor) {
+    // Knock-knock-knockin' on heaven's door
+    actor->die();
+  };
+  forEachOverlapping({ACTOR_HUMAN, ACTOR_ZOMBIE, ACTOR_GOODIE, ACTOR_HAZARD},
+                     x, y, kill);
 }
 
-int StudentWorld::unifRandomInt(const int &min, const int &max) const {
-  random_device rd;
-  uniform_int_distribution<int> dist(min, max);
-  return dist(rd);
+Actor *StudentWorld::getNearestZombie(const int &x, const int &y) const {
+  return getNearestIn(m_partitions[ACTOR_ZOMBIE], x, y);
 }
 
-bool StudentWorld::bernoulliRandomBool(const double &p) const {
-  random_device rd;
-  bernoulli_distribution dist(p);
-  return dist(rd);
+Actor *StudentWorld::getNearestHuman(const int &x, const int &y) const {
+  return getNearestIn(m_partitions[ACTOR_HUMAN], x, y);
+}
+
+// The actor in the grid with the smallest distBetween to (x, y), the first
+// added winning ties, as long as that is less than the diagonal of the view.
+// The rings of cells around (x, y) are searched outwards until no farther
+// ring can hold anyone as near, comparing squared distances: distBetween is
+// d exactly when the squared distance is within [d * d, (d + 1) * (d + 1)).
+Actor *StudentWorld::getNearestIn(const SpatialGrid &grid, const int &x,
+                                  const int &y) const {
+  Actor *nearest = nullptr;
+  int minDist = distBetween(0, 0, VIEW_WIDTH, VIEW_HEIGHT) + 1;
+  int closer = minDist * minDist;       // squared distances nearer still
+  int asClose = beyondSquared(minDist); // as near as the nearest
+  for (int r = 0; r < SpatialGrid::ringCount(); r++) {
+    if (SpatialGrid::ringDistance(r) >= minDist + 1)
+      break;
+    grid.forEachInRing(x, y, r, [&](Actor *actor, const int &actorX,
+                                    const int &actorY) {
+      int const d = distSquared(actorX, actorY, x, y);
+      if (d < closer || (nearest != nullptr && d < asClose &&
+                         actor->spawnOrder() < nearest->spawnOrder())) {
+        nearest = actor;
+        minDist = distFromSquared(d);
+        closer = minDist * minDist;
+        asClose = beyondSquared(minDist);
+      }
+    });
+  }
+  return nearest;
 }
@@ -25,10 +25,17 @@
 #define ZOMBIE_MOVEMENT_RANGE_MIN 3
 #define ZOMBIE_MOVEMENT_RANGE_MAX 10
 
+#include "ActorStore.h"
+#include "FlowField.h"
 #include "GameWorld.h"
 #include "GraphObject.h"
+#include "Random.h"
+#include "SpatialGrid.h"
+#include "WallBitmap.h"
 
-#include <list>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
 
 class Actor;
 class Penelope;
@@ -45,12 +52,14 @@ public:
   // Accessors
   int citizenCount() const { return m_nCitizen; }
   bool levelFinished() const { return m_levelFinished; }
-  bool playerDied() const { return player()->willBeRemoved(); }
+  bool playerDied() const { return m_playerDied; }
   Penelope *player() const { return m_player; }
 
   void setPlayer(Penelope *player) { m_player = player; }
-  void addActor(Actor *actor) { m_actors.push_back(actor); }
-  void removeActor(Actor *actor) { m_actors.remove(actor); }
+  void addActor(Actor *actor);
+  // the actor the handle refers to, or nullptr if it is gone
+  Actor *actor(const ActorHandle &handle) const { return m_actors.get(handle); }
+  void actorMoved(Actor *actor, const int &oldX, const int &oldY);
 
   // Actor adders
   bool addPlayer(const double &x, const double &y);
@@ -67,43 +76,48 @@ public:
   bool addFlame(const double &x, const double &y, const Direction &dir);
   bool addVomit(const double &x, const double &y, const Direction &dir);
 
-  // Helpers
-  bool squareOverlap(const double &x1, const double &y1, const double &x2,
-                     const double &y2, const double &sideX,
-                     const double &sideY) const;
-  bool squareOverlap(const Actor *obj, const double &x2, const double &y2,
-                     const double &width, const double &height) const;
-  bool squareOverlap(const Actor *obj1, const Actor *obj2, const double &width,
-                     const double &height) const;
-  int distBetween(const double &x1, const double &y1, const double &x2,
-                  const double &y2) const;
-  int distBetween(const Actor *obj, const double &x, const double &y) const;
+  // Helpers; positions are whole pixels (see Geometry.h)
+  bool squareOverlap(const int &x1, const int &y1, const int &x2,
+                     const int &y2, const int &sideX, const int &sideY) const;
+  bool squareOverlap(const Actor *obj, const int &x2, const int &y2,
+                     const int &width, const int &height) const;
+  bool squareOverlap(const Actor *obj1, const Actor *obj2, const int &width,
+                     const int &height) const;
+  int distBetween(const int &x1, const int &y1, const int &x2,
+                  const int &y2) const;
+  int distBetween(const Actor *obj, const int &x, const int &y) const;
   int distBetween(const Actor *obj1, const Actor *obj2) const;
-  bool checkOverlap(const double &x1, const double &y1, const double &x2,
-                    const double &y2) const;
-  bool checkOverlap(const Actor *obj, const double &x, const double &y) const;
+  bool checkOverlap(const int &x1, const int &y1, const int &x2,
+                    const int &y2) const;
+  bool checkOverlap(const Actor *obj, const int &x, const int &y) const;
   bool checkOverlap(const Actor *obj1, const Actor *obj2) const;
-  bool checkOverlapWithHuman(const double &x, const double &y) const;
-  bool checkOverlapWithAgent(const double &x, const double &y) const;
-  bool checkNear(const Actor *obj1, const Actor *obj2) const {
-    return distBetween(obj1, obj2) <= NEAR_DISTANCE;
-  }
-  bool checkFlammableAt(const double &x, const double &y) const;
+  bool checkOverlapWithHuman(const int &x, const int &y) const;
+  bool checkOverlapWithAgent(const int &x, const int &y) const;
+  bool checkNear(const Actor *obj1, const Actor *obj2) const;
+  bool checkFlammableAt(const int &x, const int &y) const;
   bool checkBlockAtDir(const Actor *obj, const Direction &dir,
-                       const double &dist) const;
+                       const int &dist) const;
 
   // Actions
-  void infectAt(const double &x, const double &y);
-  void evacuateAt(const double &x, const double &y);
-  void killAt(const double &x, const double &y);
-
-  Actor *getNearestZombie(const double &x, const double &y) const;
-  Actor *getNearestHuman(const double &x, const double &y) const;
-
-  // Random Generators
-  int unifRandomInt(const int &min, const int &max) const;
-  bool bernoulliRandomBool(const double &p) const;
-  Direction randomDirection() const { return unifRandomInt(0, 3) * 90; };
+  void infectAt(const int &x, const int &y);
+  void evacuateAt(const int &x, const int &y);
+  void killAt(const int &x, const int &y);
+
+  Actor *getNearestZombie(const int &x, const int &y) const;
+  Actor *getNearestHuman(const int &x, const int &y) const;
+  // the ways around the walls to Penelope and to the nearest human, from
+  // everywhere in the level, as they were at the start of the tick
+  const FlowField &fieldTowardPenelope() const { return m_towardPenelope; }
+  const FlowField &fieldTowardHumans() const { return m_towardHumans; }
+
+  // Random Generators; every actor gets a stream split off the world's when
+  // it is added, so a seed replays the same game
+  void setSeed(const uint64_t &seed) { m_random.reseed(seed); }
+  int unifRandomInt(const int &min, const int &max) {
+    return m_random.uniformInt(min, max);
+  }
+  bool bernoulliRandomBool(const double &p) { return m_random.bernoulli(p); }
+  Direction randomDirection() { return unifRandomInt(0, 3) * 90; };
 
   void incCitizenCount() { m_nCitizen++; }
   void decCitizenCount() { m_nCitizen--; }
@@ -113,8 +127,31 @@ public:
   }
 
 private:
-  list<Actor *> m_actors;
+  // call act(actor) on every actor overlapping (x, y) that is not about to be
+  // removed, in the order they were added
+  template <typename Act>
+  void forEachOverlapping(initializer_list<ActorKind> kinds, const int &x,
+                          const int &y, Act act);
+  // whether visit(actor) is true for any actor of the kinds overlapping
+  // (x, y)
+  template <typename Visit>
+  bool anyOverlapping(initializer_list<ActorKind> kinds, const int &x,
+                      const int &y, Visit visit) const;
+  Actor *getNearestIn(const SpatialGrid &grid, const int &x,
+                      const int &y) const;
+  void updateFields();
+  void indexActor(Actor *actor);
+  void unindexActor(Actor *actor);
+
+  ActorStore m_actors;
+  vector<Actor *> m_dead; // the actors collected at the end of the tick
+  SpatialGrid m_partitions[N_ACTOR_KINDS]; // the actors of each kind
+  WallBitmap m_wallBitmap;                 // where the walls block agents
+  FlowField m_towardPenelope, m_towardHumans;
+  long m_nSpawned = 0;      // actors added so far
+  Rng m_random;
   Penelope *m_player;
+  bool m_playerDied = false; // Penelope is gone, and m_player with her
   int m_nCitizen = 0; // actors that need to be saved, Penelope included
   bool m_levelFinished = false;
 };
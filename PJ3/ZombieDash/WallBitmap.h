@@ -0,0 +1,57 @@
+#ifndef WALLBITMAP_H_
+#define WALLBITMAP_H_
+
+#include "GameConstants.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// One bit per pixel position, set where an agent would run into a wall.
+// Walls never move, so each one is stamped in once as the square of
+// positions it blocks, and a blocking test is then a single bit test. The
+// bitmap covers the view plus a sprite's margin around it, which is as far
+// as anything blocked by a wall inside the view can be.
+class WallBitmap {
+public:
+  WallBitmap() : m_bits(HEIGHT * WORDS_PER_ROW) {}
+
+  // a wall at (x, y) blocks every position less than a sprite away from it
+  // along both axes
+  void addWall(const int &x, const int &y) {
+    int const x1 = max(x - (SPRITE_WIDTH - 1), -MARGIN);
+    int const x2 = min(x + (SPRITE_WIDTH - 1), WIDTH - MARGIN - 1);
+    int const y1 = max(y - (SPRITE_HEIGHT - 1), -MARGIN);
+    int const y2 = min(y + (SPRITE_HEIGHT - 1), HEIGHT - MARGIN - 1);
+    for (int py = y1; py <= y2; py++)
+      for (int px = x1; px <= x2; px++)
+        m_bits[word(px, py)] |= bit(px);
+  }
+  bool blocks(const int &x, const int &y) const {
+    if (x < -MARGIN || x >= WIDTH - MARGIN || y < -MARGIN ||
+        y >= HEIGHT - MARGIN)
+      return false;
+    return (m_bits[word(x, y)] & bit(x)) != 0;
+  }
+  void clear() { fill(m_bits.begin(), m_bits.end(), 0); }
+
+private:
+  static const int MARGIN = SPRITE_WIDTH > SPRITE_HEIGHT ? SPRITE_WIDTH
+                                                         : SPRITE_HEIGHT;
+  static const int WIDTH = VIEW_WIDTH + 2 * MARGIN;
+  static const int HEIGHT = VIEW_HEIGHT + 2 * MARGIN;
+  static const int WORDS_PER_ROW = (WIDTH + 63) / 64;
+
+  static int word(const int &x, const int &y) {
+    return (y + MARGIN) * WORDS_PER_ROW + (x + MARGIN) / 64;
+  }
+  static uint64_t bit(const int &x) {
+    return uint64_t(1) << ((x + MARGIN) % 64);
+  }
+
+  vector<uint64_t> m_bits;
+};
+
+#endif // WALLBITMAP_H_
@@ -0,0 +1,181 @@
+// Checks the integer geometry against the double helpers StudentWorld used to
+// have, over every offset a level can produce, and the grid's batched queries
+// against testing every actor one by one. Build and run it with `make test`.
+
+#include "GameConstants.h"
+#include "Geometry.h"
+#include "SpatialGrid.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+#define OVERLAP_DISTANCE 10
+#define NEAR_DISTANCE 80
+
+// the helpers as they were, in doubles
+
+int oldDistBetween(const double &x1, const double &y1, const double &x2,
+                   const double &y2) {
+  double dx = x1 - x2;
+  double dy = y1 - y2;
+  return sqrt(dx * dx + dy * dy);
+}
+
+bool oldCheckOverlap(const double &x1, const double &y1, const double &x2,
+                     const double &y2) {
+  return oldDistBetween(x1, y1, x2, y2) <= OVERLAP_DISTANCE;
+}
+
+bool oldCheckNear(const double &x1, const double &y1, const double &x2,
+                  const double &y2) {
+  return oldDistBetween(x1, y1, x2, y2) <= NEAR_DISTANCE;
+}
+
+bool oldSquareOverlap(const double &x1, const double &y1, const double &x2,
+                      const double &y2, const double &width,
+                      const double &height) {
+  if (x2 >= x1 - width && x2 <= x1 + width && y2 >= y1 - height &&
+      y2 <= y1 + height) {
+    return true;
+  }
+  if (y2 >= y1 - height && y2 <= y1 + height && x2 >= x1 - width &&
+      x2 <= x1 + width) {
+    return true;
+  }
+  return false;
+}
+
+// stand-ins for actors; the grid never looks inside them
+Actor *fakeActor(const size_t &i) {
+  static char actors[1024];
+  return reinterpret_cast<Actor *>(&actors[i]);
+}
+
+int main() {
+  // Distances
+
+  // every offset between two positions in or just around the view, and a
+  // few origins to make sure only the offset matters
+  int const span = max(VIEW_WIDTH, VIEW_HEIGHT) + 2 * SPRITE_WIDTH;
+  for (int x1 : {0, 16, 117, 240})
+    for (int y1 : {0, 93, 240})
+      for (int dx = -span; dx <= span; dx++)
+        for (int dy = -span; dy <= span; dy++) {
+          int const x2 = x1 + dx, y2 = y1 + dy;
+          int const d = distSquared(x1, y1, x2, y2);
+          assert(distFromSquared(d) == oldDistBetween(x1, y1, x2, y2));
+          assert(withinDist(x1, y1, x2, y2, OVERLAP_DISTANCE) ==
+                 oldCheckOverlap(x1, y1, x2, y2));
+          assert(withinDist(x1, y1, x2, y2, NEAR_DISTANCE) ==
+                 oldCheckNear(x1, y1, x2, y2));
+          assert(withinSquare(x1, y1, x2, y2, SPRITE_WIDTH - 1,
+                              SPRITE_HEIGHT - 1) ==
+                 oldSquareOverlap(x1, y1, x2, y2, SPRITE_WIDTH - 1,
+                                  SPRITE_HEIGHT - 1));
+        }
+  // the edges
+  assert(withinDist(0, 0, 10, 0, OVERLAP_DISTANCE));
+  assert(!withinDist(0, 0, 11, 0, OVERLAP_DISTANCE));
+  assert(withinDist(0, 0, 7, 7, OVERLAP_DISTANCE));  // 9.89
+  assert(withinDist(0, 0, 6, 9, OVERLAP_DISTANCE));  // 10.8, rounds to 10
+  assert(!withinDist(0, 0, 8, 8, OVERLAP_DISTANCE)); // 11.3
+  assert(beyondSquared(OVERLAP_DISTANCE) == 121);
+  assert(beyondSquared(NEAR_DISTANCE) == 6561);
+
+  // SpatialGrid
+
+  mt19937 random(2019);
+  uniform_int_distribution<int> position(-SPRITE_WIDTH,
+                                         VIEW_WIDTH + SPRITE_WIDTH);
+  uniform_int_distribution<int> step(-4, 4);
+  size_t const nActors = 600;
+  vector<int> xs(nActors), ys(nActors);
+  SpatialGrid grid;
+  for (size_t i = 0; i < nActors; i++) {
+    xs[i] = position(random);
+    ys[i] = position(random);
+    grid.insert(fakeActor(i), xs[i], ys[i]);
+  }
+  for (int round = 0; round < 50; round++) {
+    // wander around, some within their cell, some out of it
+    for (size_t i = 0; i < nActors; i++) {
+      int const x = xs[i] + step(random), y = ys[i] + step(random);
+      grid.move(fakeActor(i), xs[i], ys[i], x, y);
+      xs[i] = x;
+      ys[i] = y;
+    }
+    for (int query = 0; query < 200; query++) {
+      int const x = position(random), y = position(random);
+      vector<Actor *> found, expected;
+
+      // anyWithin finds exactly the overlapping actors
+      grid.anyWithin(x, y, OVERLAP_DISTANCE, [&](Actor *actor) {
+        found.push_back(actor);
+        return false;
+      });
+      for (size_t i = 0; i < nActors; i++)
+        if (oldCheckOverlap(xs[i], ys[i], x, y))
+          expected.push_back(fakeActor(i));
+      sort(found.begin(), found.end());
+      assert(found == expected);
+
+      // and stops at the first one visit returns true for
+      int visited = 0;
+      bool any = grid.anyWithin(x, y, OVERLAP_DISTANCE, [&](Actor *) {
+        visited++;
+        return true;
+      });
+      assert(any == !expected.empty());
+      assert(visited == (any ? 1 : 0));
+
+      // anyInSquare finds exactly the actors blocking the spot
+      found.clear();
+      expected.clear();
+      grid.anyInSquare(x, y, SPRITE_WIDTH - 1, SPRITE_HEIGHT - 1,
+                       [&](Actor *actor) {
+                         found.push_back(actor);
+                         return false;
+                       });
+      for (size_t i = 0; i < nActors; i++)
+        if (oldSquareOverlap(x, y, xs[i], ys[i], SPRITE_WIDTH - 1,
+                             SPRITE_HEIGHT - 1))
+          expected.push_back(fakeActor(i));
+      sort(found.begin(), found.end());
+      assert(found == expected);
+    }
+    // the rings visit every actor once, where it is
+    vector<int> seen(nActors, 0);
+    int const x = position(random), y = position(random);
+    for (int r = 0; r < SpatialGrid::ringCount(); r++)
+      grid.forEachInRing(x, y, r, [&](Actor *actor, const int &actorX,
+                                      const int &actorY) {
+        size_t const i = reinterpret_cast<char *>(actor) -
+                         reinterpret_cast<char *>(fakeActor(0));
+        assert(actorX == xs[i] && actorY == ys[i]);
+        // no closer than the ring says
+        assert(oldDistBetween(actorX, actorY, x, y) >=
+               SpatialGrid::ringDistance(r));
+        seen[i]++;
+      });
+    assert(count(seen.begin(), seen.end(), 1) == static_cast<long>(nActors));
+  }
+  // removed actors are gone
+  for (size_t i = 0; i < nActors; i += 2)
+    grid.remove(fakeActor(i), xs[i], ys[i]);
+  for (size_t i = 0; i < nActors; i++) {
+    bool found = grid.anyWithin(xs[i], ys[i], 0, [&](Actor *actor) {
+      return actor == fakeActor(i);
+    });
+    assert(found == (i % 2 == 1));
+  }
+
+  cout << "Pass all tests!" << endl;
+
+  return 0;
+}
@@ -0,0 +1,138 @@
+// Runs ZombieDash without a window, sound or frame timer: the world has no
+// controller, Penelope is steered by random or scripted keys, and the levels
+// are played through as fast as the world can tick. Meant for load tests and
+// batch runs of the AI; build it with `make headless`.
+//
+// usage: headless [assets directory] [max ticks] [key seed | key file]
+//                 [world seed]
+//
+// The same keys and world seed play out the same game every time.
+//
+// A key file holds one key per tick, cycled through until the run is over:
+// L, R, U and D are the arrows, space, t and e are space, tab and enter, and
+// any other char is no key at all.
+
+#include "GameConstants.h"
+#include "StudentWorld.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <string>
+
+using namespace std;
+
+int main(int argc, char *argv[]) {
+  string assetPath = argc > 1 ? argv[1] : "Assets";
+  long maxTicks = argc > 2 ? atol(argv[2]) : 100000;
+  string keys = argc > 3 ? argv[3] : "0";
+  uint64_t seed = argc > 4 ? strtoull(argv[4], nullptr, 10) : 0;
+  if (!assetPath.empty())
+    assetPath += '/';
+  if (!ifstream(assetPath + "level01.txt")) {
+    cout << "Cannot find level01.txt in "
+         << (assetPath.empty() ? "current directory" : assetPath) << endl;
+    return 1;
+  }
+
+  StudentWorld *world = new StudentWorld(assetPath);
+  world->setSeed(seed);
+  ifstream keyFile(keys);
+  string script;
+  mt19937 keyRandom;
+  if (keyFile) {
+    script.assign(istreambuf_iterator<char>(keyFile),
+                  istreambuf_iterator<char>());
+    if (script.empty()) {
+      cout << "No keys in " << keys << endl;
+      return 1;
+    }
+  } else {
+    keyRandom.seed(atol(keys.c_str()));
+  }
+  size_t nextKey = 0;
+  world->setKeySource([&](int &key) {
+    if (!script.empty()) {
+      switch (script[nextKey++ % script.size()]) {
+      case 'L':
+        key = KEY_PRESS_LEFT;
+        return true;
+      case 'R':
+        key = KEY_PRESS_RIGHT;
+        return true;
+      case 'U':
+        key = KEY_PRESS_UP;
+        return true;
+      case 'D':
+        key = KEY_PRESS_DOWN;
+        return true;
+      case ' ':
+        key = KEY_PRESS_SPACE;
+        return true;
+      case 't':
+        key = KEY_PRESS_TAB;
+        return true;
+      case 'e':
+        key = KEY_PRESS_ENTER;
+        return true;
+      default:
+        return false;
+      }
+    }
+    // mostly walk around, now and then use a goodie, sometimes do nothing
+    static const int walk[] = {KEY_PRESS_LEFT, KEY_PRESS_RIGHT, KEY_PRESS_UP,
+                               KEY_PRESS_DOWN};
+    static const int use[] = {KEY_PRESS_SPACE, KEY_PRESS_TAB,
+                              KEY_PRESS_ENTER};
+    int roll = keyRandom() % 100;
+    if (roll < 40)
+      return false;
+    key = roll < 97 ? walk[roll % 4] : use[roll % 3];
+    return true;
+  });
+
+  // the same states GameController goes through, minus the prompts
+  auto start = chrono::steady_clock::now();
+  long ticks = 0;
+  int status = world->init();
+  while (ticks < maxTicks && status != GWSTATUS_PLAYER_WON) {
+    if (status == GWSTATUS_LEVEL_ERROR) {
+      cout << "Error in level data file encoding!" << endl;
+      return 1;
+    }
+    status = world->move();
+    ticks++;
+    if (status == GWSTATUS_PLAYER_DIED) {
+      // the last level is cleaned up once, on the way out
+      if (world->isGameOver())
+        break;
+      world->cleanUp();
+      status = world->init();
+    } else if (status == GWSTATUS_FINISHED_LEVEL) {
+      world->advanceToNextLevel();
+      world->cleanUp();
+      status = world->init();
+    }
+  }
+  double seconds =
+      chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+  if (status == GWSTATUS_PLAYER_WON)
+    cout << "You won the game!";
+  else if (world->isGameOver())
+    cout << "Game Over!";
+  else
+    cout << "Out of ticks on level " << world->getLevel() << ".";
+  cout << " Final score: " << world->getScore()
+       << ", lives left: " << world->getLives() << endl;
+  cout << ticks << " ticks in " << seconds << " s, "
+       << static_cast<long>(seconds > 0 ? ticks / seconds : 0) << " ticks/s"
+       << endl;
+  world->cleanUp();
+  delete world;
+  return 0;
+}
@@ -0,0 +1,63 @@
+//
+//  Alphabet.h
+//  PJ4
+//
+//  Created by Jim Zenn on 10/19/26.
+//  Copyright © 2019 UCLA. All rights reserved.
+//
+
+#ifndef Alphabet_h
+#define Alphabet_h
+
+// An alphabet maps the symbols of a key to dense indices 0..size-1, so that a
+// trie node can keep its children in an array sized for the alphabet.
+// index() returns -1 for a symbol outside the alphabet.
+
+// the symbol -> index table of an alphabet whose symbols are listed in order
+struct AlphabetTable {
+  signed char indices[256];
+  constexpr AlphabetTable(const char *symbols, bool foldCase) : indices() {
+    for (int i = 0; i < 256; i++)
+      indices[i] = -1;
+    for (int i = 0; symbols[i] != '\0'; i++) {
+      unsigned char const symbol = static_cast<unsigned char>(symbols[i]);
+      indices[symbol] = static_cast<signed char>(i);
+      if (foldCase && symbol >= 'A' && symbol <= 'Z')
+        indices[symbol - 'A' + 'a'] = static_cast<signed char>(i);
+    }
+  }
+  constexpr int operator[](char symbol) const {
+    return indices[static_cast<unsigned char>(symbol)];
+  }
+};
+
+// every char is its own symbol
+struct ByteAlphabet {
+  static constexpr int size = 256;
+  static constexpr int index(char symbol) {
+    return static_cast<unsigned char>(symbol);
+  }
+};
+
+// the four bases, either case
+struct DNA4Alphabet {
+  static constexpr int size = 4;
+  static constexpr AlphabetTable table{"ACGT", true};
+  static constexpr int index(char symbol) { return table[symbol]; }
+};
+
+// the four bases and N (unknown), either case
+struct DNA5Alphabet {
+  static constexpr int size = 5;
+  static constexpr AlphabetTable table{"ACGTN", true};
+  static constexpr int index(char symbol) { return table[symbol]; }
+};
+
+// the twenty standard amino acids, either case
+struct ProteinAlphabet {
+  static constexpr int size = 20;
+  static constexpr AlphabetTable table{"ACDEFGHIKLMNPQRSTVWY", true};
+  static constexpr int index(char symbol) { return table[symbol]; }
+};
+
+#endif /* Alphabet_h */
@@ -0,0 +1,149 @@
+//
+//  Arena.h
+//  PJ4
+//
+//  Created by Jim Zenn on 10/19/26.
+//  Copyright © 2019 UCLA. All rights reserved.
+//
+
+#ifndef Arena_h
+#define Arena_h
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define ARENA_USES_MMAP 1
+#endif
+
+using namespace std;
+
+// How an Arena gets its blocks from the system.
+struct ArenaOptions {
+  size_t blockSize = 1 << 20;
+  // Back the blocks with huge pages, so that walking a large structure in the
+  // arena misses the TLB far less often. Explicit huge pages are used if the
+  // system has some reserved, transparent ones otherwise; blocks are rounded
+  // up to whole huge pages. Ignored where mmap is not available.
+  bool hugePages = false;
+  // Touch every page of a block as soon as it is allocated, so the page
+  // faults are taken while building rather than on first use.
+  bool prefault = false;
+};
+
+// A monotonic arena: each allocation bumps a pointer in the current block,
+// and memory is only given back, all at once, when the arena is released.
+class Arena {
+public:
+  Arena(size_t blockSize = 1 << 20) { m_options.blockSize = blockSize; }
+  Arena(const ArenaOptions &options) : m_options(options) {}
+  ~Arena() { release(); }
+  void *allocate(size_t size, size_t alignment) {
+    char *start = alignUp(m_cursor, alignment);
+    // aligning can take start past the end of a nearly full block
+    if (m_cursor == nullptr || start > m_end ||
+        size > static_cast<size_t>(m_end - start)) {
+      // start a new block; oversized requests get a block of their own
+      Block const block = allocateBlock(max(m_options.blockSize,
+                                            size + alignment));
+      m_blocks.push_back(block);
+      m_end = block.start + block.size;
+      start = alignUp(block.start, alignment);
+    }
+    m_cursor = start + size;
+    return start;
+  }
+  // free every block; everything allocated from the arena becomes invalid
+  void release() {
+    for (Block const &block : m_blocks)
+      freeBlock(block);
+    m_blocks.clear();
+    m_cursor = m_end = nullptr;
+  }
+  // C++11 syntax for preventing copying and assignment
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+private:
+  static size_t const PAGE_BYTES = 4096;
+  static size_t const HUGE_PAGE_BYTES = 2 << 20;
+  struct Block {
+    char *start;
+    size_t size;
+    bool mapped; // from mmap rather than malloc
+  };
+  static char *alignUp(char *p, size_t alignment) {
+    uintptr_t const address = reinterpret_cast<uintptr_t>(p);
+    return p + ((alignment - address % alignment) % alignment);
+  }
+  Block allocateBlock(size_t size) {
+    Block block{nullptr, size, false};
+#ifdef ARENA_USES_MMAP
+    if (m_options.hugePages)
+      block = mapHugeBlock(size);
+#endif
+    if (block.start == nullptr) {
+      // a failed mapping may have rounded the size up to whole huge pages;
+      // the block is only as big as what malloc gives
+      block = Block{static_cast<char *>(malloc(size)), size, false};
+      if (block.start == nullptr)
+        throw bad_alloc();
+    }
+    if (m_options.prefault)
+      for (size_t offset = 0; offset < block.size; offset += PAGE_BYTES)
+        static_cast<volatile char *>(block.start)[offset] = 0;
+    return block;
+  }
+  void freeBlock(Block const &block) {
+#ifdef ARENA_USES_MMAP
+    if (block.mapped) {
+      munmap(block.start, block.size);
+      return;
+    }
+#endif
+    free(block.start);
+  }
+#ifdef ARENA_USES_MMAP
+  // map a block of whole huge pages; the start is null if mapping failed
+  static Block mapHugeBlock(size_t size) {
+    size = (size + HUGE_PAGE_BYTES - 1) / HUGE_PAGE_BYTES * HUGE_PAGE_BYTES;
+    int const protection = PROT_READ | PROT_WRITE;
+    int const flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_HUGETLB
+    // explicit huge pages only exist if the administrator reserved some
+    void *explicitPages =
+        mmap(nullptr, size, protection, flags | MAP_HUGETLB, -1, 0);
+    if (explicitPages != MAP_FAILED)
+      return Block{static_cast<char *>(explicitPages), size, true};
+#endif
+    // transparent huge pages need 2 MiB aligned ranges, so map an extra huge
+    // page and trim the unaligned ends
+    size_t const mappedSize = size + HUGE_PAGE_BYTES;
+    void *mapped = mmap(nullptr, mappedSize, protection, flags, -1, 0);
+    if (mapped == MAP_FAILED)
+      return Block{nullptr, size, false};
+    char *const start = alignUp(static_cast<char *>(mapped), HUGE_PAGE_BYTES);
+    size_t const head = start - static_cast<char *>(mapped);
+    if (head > 0)
+      munmap(mapped, head);
+    if (mappedSize - head > size)
+      munmap(start + size, mappedSize - head - size);
+#ifdef MADV_HUGEPAGE
+    madvise(start, size, MADV_HUGEPAGE);
+#endif
+    return Block{start, size, true};
+  }
+#endif
+
+  ArenaOptions m_options;
+  vector<Block> m_blocks;
+  char *m_cursor = nullptr; // the next free byte in the current block
+  char *m_end = nullptr;    // the end of the current block
+};
+
+#endif /* Arena_h */
@@ -0,0 +1,77 @@
+//
+//  BloomFilter.h
+//  PJ4
+//
+//  Created by Jim Zenn on 10/19/26.
+//  Copyright © 2019 UCLA. All rights reserved.
+//
+
+#ifndef BloomFilter_h
+#define BloomFilter_h
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+using namespace std;
+
+// A blocked Bloom filter over 64-bit key hashes. All the bits of a key live in
+// the same 512-bit block, so a lookup touches a single cache line.
+class BloomFilter {
+public:
+  BloomFilter() {}
+  // empty the filter and size it for the expected number of keys, spending
+  // about bitsPerKey bits on each
+  void reset(size_t expectedKeys, int bitsPerKey) {
+    size_t const bits = expectedKeys * static_cast<size_t>(bitsPerKey);
+    m_blocks.assign(bits / BLOCK_BITS + 1, Block());
+    m_capacity = expectedKeys;
+    m_size = 0;
+    // the number of probes that minimizes the false positive rate
+    m_nProbes = static_cast<int>(lround(bitsPerKey * log(2.0)));
+    if (m_nProbes < 1)
+      m_nProbes = 1;
+    if (m_nProbes > 16)
+      m_nProbes = 16;
+  }
+  void insert(uint64_t hash) {
+    Block &block = m_blocks[blockIndex(hash)];
+    uint32_t bit = static_cast<uint32_t>(hash);
+    uint32_t const step = (bit >> 16) | 1;
+    for (int i = 0; i < m_nProbes; i++, bit += step)
+      block.words[(bit % BLOCK_BITS) / 64] |= uint64_t(1) << (bit % 64);
+    m_size++;
+  }
+  // false if the key was definitely never inserted
+  bool mayContain(uint64_t hash) const {
+    if (m_blocks.empty())
+      return false;
+    Block const &block = m_blocks[blockIndex(hash)];
+    uint32_t bit = static_cast<uint32_t>(hash);
+    uint32_t const step = (bit >> 16) | 1;
+    for (int i = 0; i < m_nProbes; i++, bit += step)
+      if (!(block.words[(bit % BLOCK_BITS) / 64] & (uint64_t(1) << (bit % 64))))
+        return false;
+    return true;
+  }
+  size_t capacity() const { return m_capacity; } // keys it was sized for
+  size_t size() const { return m_size; }         // keys inserted so far
+
+private:
+  static int const BLOCK_BITS = 512;
+  struct alignas(64) Block {
+    uint64_t words[BLOCK_BITS / 64] = {};
+  };
+  // the high 32 bits of the hash pick the block; the low 32 bits pick the
+  // bits to set in it
+  size_t blockIndex(uint64_t hash) const {
+    return static_cast<size_t>(((hash >> 32) * m_blocks.size()) >> 32);
+  }
+
+  vector<Block> m_blocks;
+  size_t m_capacity = 0;
+  size_t m_size = 0;
+  int m_nProbes = 1;
+};
+
+#endif /* BloomFilter_h */
@@ -0,0 +1,259 @@
+//
+//  CompressedSequence.h
+//  PJ4
+//
+//  Created by Jim Zenn on 10/19/26.
+//  Copyright © 2019 UCLA. All rights reserved.
+//
+
+#ifndef CompressedSequence_h
+#define CompressedSequence_h
+
+#include "Kmer.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// A DNA sequence stored in fixed-size blocks, each compressed on its own, so
+// any range can be extracted by decompressing only the blocks it overlaps.
+//
+// Each block is packed two bits per base, with the stretches of any other
+// char (N, mostly) kept aside as runs; repeats within the block are replaced
+// by LZ77-style back-references. The most recently decompressed blocks are
+// kept in a small cache, since queries tend to extract nearby ranges. The
+// cache is only locked to look a block up or put one in; blocks are
+// decompressed and copied out with it unlocked, so threads extracting from
+// the same sequence only wait on each other for that long.
+class CompressedSequence {
+public:
+  CompressedSequence(const string &sequence, int blockSize = 4096,
+                     int nCachedBlocks = 8);
+  int length() const { return m_length; }
+  // the bytes held by the compressed blocks and their index, not counting
+  // the cache
+  size_t compressedSize() const {
+    return m_data.size() + m_blockOffsets.size() * sizeof(size_t);
+  }
+  // copy the length chars starting at position to fragment; the range must
+  // be within the sequence
+  void extract(int position, int length, string &fragment) const;
+  // C++11 syntax for preventing copying and assignment
+  CompressedSequence(const CompressedSequence &) = delete;
+  CompressedSequence &operator=(const CompressedSequence &) = delete;
+
+private:
+  static int const MIN_MATCH_LENGTH = 12; // shorter repeats stay literal
+  static int const HASH_BITS = 12;
+  void compressBlock(const char *bases, int nBases);
+  void decompressBlock(int block, string &bases) const;
+  static void putVarint(vector<uint8_t> &data, size_t value);
+  static size_t getVarint(const uint8_t *&p);
+
+  int m_length;
+  int m_blockSize;
+  vector<uint8_t> m_data;
+  vector<size_t> m_blockOffsets; // block i is m_data[offsets[i], offsets[i+1])
+  struct CachedBlock {
+    int block = -1;
+    // shared with the extracts still copying out of it, so a slot can be
+    // refilled under them
+    shared_ptr<const string> bases;
+  };
+  // the decompressed block, from the cache if it is there
+  shared_ptr<const string> blockBases(int block) const;
+
+  mutable vector<CachedBlock> m_cache; // slot block % size holds the block
+  mutable mutex m_cacheMutex;          // guards m_cache
+};
+
+inline CompressedSequence::CompressedSequence(const string &sequence,
+                                              int blockSize, int nCachedBlocks)
+    : m_length(static_cast<int>(sequence.size())), m_blockSize(blockSize),
+      m_cache(max(nCachedBlocks, 1)) {
+  for (int start = 0; start < m_length; start += m_blockSize) {
+    m_blockOffsets.push_back(m_data.size());
+    compressBlock(sequence.data() + start, min(m_blockSize, m_length - start));
+  }
+  m_blockOffsets.push_back(m_data.size());
+  m_data.shrink_to_fit();
+}
+
+inline void CompressedSequence::extract(int position, int length,
+                                        string &fragment) const {
+  fragment.clear();
+  fragment.reserve(length);
+  while (length > 0) {
+    int const block = position / m_blockSize;
+    shared_ptr<const string> const bases = blockBases(block);
+    int const offset = position - block * m_blockSize;
+    int const n = min(length, static_cast<int>(bases->size()) - offset);
+    fragment.append(*bases, offset, n);
+    position += n;
+    length -= n;
+  }
+}
+
+inline shared_ptr<const string>
+CompressedSequence::blockBases(int block) const {
+  CachedBlock &cached = m_cache[block % m_cache.size()];
+  {
+    lock_guard<mutex> lock(m_cacheMutex);
+    if (cached.block == block)
+      return cached.bases;
+  }
+  // two threads missing on the same block both decompress it; either copy
+  // will do for the cache
+  auto bases = make_shared<string>();
+  decompressBlock(block, *bases);
+  lock_guard<mutex> lock(m_cacheMutex);
+  cached.block = block;
+  cached.bases = bases;
+  return bases;
+}
+
+// A block is laid out as:
+//   the runs of chars other than A, C, G and T: count, then (distance from
+//   the end of the previous run, length, char) for each
+//   the literal bases: count, then four bases per byte
+//   the tokens, up to the end of the block: (number of literal bases,
+//   match length, and the match's distance back if the length is not 0)
+inline void CompressedSequence::compressBlock(const char *bases, int nBases) {
+  vector<uint8_t> codes(nBases);
+  vector<int> runs; // (start, length, char) triples
+  for (int i = 0; i < nBases; i++) {
+    int const code = baseCode(bases[i]);
+    codes[i] = static_cast<uint8_t>(code < 0 ? 0 : code);
+    if (code >= 0)
+      continue;
+    size_t const n = runs.size();
+    if (n > 0 && runs[n - 1] == static_cast<unsigned char>(bases[i]) &&
+        runs[n - 3] + runs[n - 2] == i)
+      runs[n - 2]++;
+    else
+      runs.insert(runs.end(), {i, 1, static_cast<unsigned char>(bases[i])});
+  }
+  putVarint(m_data, runs.size() / 3);
+  int runEnd = 0;
+  for (size_t i = 0; i < runs.size(); i += 3) {
+    putVarint(m_data, runs[i] - runEnd);
+    putVarint(m_data, runs[i + 1]);
+    m_data.push_back(static_cast<uint8_t>(runs[i + 2]));
+    runEnd = runs[i] + runs[i + 1];
+  }
+  // greedy LZ77 parse: hash the next MIN_MATCH_LENGTH bases to find the
+  // last place they occurred in the block
+  vector<int> lastSeen(1 << HASH_BITS, -1);
+  auto hashAt = [&](int i) {
+    uint32_t packed = 0;
+    for (int j = 0; j < MIN_MATCH_LENGTH; j++)
+      packed = (packed << 2) | codes[i + j];
+    return static_cast<uint32_t>(mixHash(packed) >> (64 - HASH_BITS));
+  };
+  vector<uint8_t> literals;
+  vector<size_t> tokens;
+  int literalStart = 0;
+  for (int i = 0; i < nBases;) {
+    int matchLength = 0, matchStart = -1;
+    if (i + MIN_MATCH_LENGTH <= nBases) {
+      uint32_t const hash = hashAt(i);
+      matchStart = lastSeen[hash];
+      lastSeen[hash] = i;
+      if (matchStart >= 0)
+        while (i + matchLength < nBases &&
+               codes[matchStart + matchLength] == codes[i + matchLength])
+          matchLength++;
+    }
+    if (matchLength < MIN_MATCH_LENGTH) {
+      i++;
+      continue;
+    }
+    literals.insert(literals.end(), codes.begin() + literalStart,
+                    codes.begin() + i);
+    tokens.insert(tokens.end(), {static_cast<size_t>(i - literalStart),
+                                 static_cast<size_t>(matchLength),
+                                 static_cast<size_t>(i - matchStart)});
+    // remember the positions inside the match too, for later repeats
+    for (int j = i + 1; j < i + matchLength && j + MIN_MATCH_LENGTH <= nBases;
+         j++)
+      lastSeen[hashAt(j)] = j;
+    i += matchLength;
+    literalStart = i;
+  }
+  literals.insert(literals.end(), codes.begin() + literalStart, codes.end());
+  tokens.insert(tokens.end(), {static_cast<size_t>(nBases - literalStart), 0});
+  putVarint(m_data, literals.size());
+  for (size_t i = 0; i < literals.size(); i += 4) {
+    uint8_t packed = 0;
+    for (size_t j = 0; j < 4 && i + j < literals.size(); j++)
+      packed |= static_cast<uint8_t>(literals[i + j] << (2 * j));
+    m_data.push_back(packed);
+  }
+  for (size_t const value : tokens)
+    putVarint(m_data, value);
+}
+
+inline void CompressedSequence::decompressBlock(int block,
+                                                string &bases) const {
+  uint8_t const *p = m_data.data() + m_blockOffsets[block];
+  uint8_t const *const end = m_data.data() + m_blockOffsets[block + 1];
+  bases.clear();
+  size_t const nRuns = getVarint(p);
+  uint8_t const *const runs = p;
+  for (size_t i = 0; i < nRuns; i++) {
+    getVarint(p);
+    getVarint(p);
+    p++;
+  }
+  size_t const nLiterals = getVarint(p);
+  uint8_t const *const literals = p;
+  p += (nLiterals + 3) / 4;
+  size_t literal = 0;
+  while (p < end) {
+    for (size_t n = getVarint(p); n > 0; n--, literal++)
+      bases.push_back(
+          "ACGT"[(literals[literal / 4] >> (2 * (literal % 4))) & 3]);
+    size_t const matchLength = getVarint(p);
+    if (matchLength == 0)
+      break;
+    // copy one base at a time, since the match may overlap itself
+    size_t const from = bases.size() - getVarint(p);
+    for (size_t i = 0; i < matchLength; i++)
+      bases.push_back(bases[from + i]);
+  }
+  // put the other chars back
+  uint8_t const *run = runs;
+  size_t runEnd = 0;
+  for (size_t i = 0; i < nRuns; i++) {
+    size_t const start = runEnd + getVarint(run);
+    size_t const length = getVarint(run);
+    char const ch = static_cast<char>(*run++);
+    fill(bases.begin() + start, bases.begin() + start + length, ch);
+    runEnd = start + length;
+  }
+}
+
+inline void CompressedSequence::putVarint(vector<uint8_t> &data,
+                                          size_t value) {
+  // seven bits per byte, low bits first; the high bit marks a continuation
+  for (; value >= 0x80; value >>= 7)
+    data.push_back(static_cast<uint8_t>(value | 0x80));
+  data.push_back(static_cast<uint8_t>(value));
+}
+
+inline size_t CompressedSequence::getVarint(const uint8_t *&p) {
+  size_t value = 0;
+  for (int shift = 0;; shift += 7) {
+    uint8_t const byte = *p++;
+    value |= static_cast<size_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return value;
+  }
+}
+
+#endif /* CompressedSequence_h */
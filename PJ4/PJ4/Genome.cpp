@@ -6,11 +6,15 @@
 //  Copyright © 2019 UCLA. All rights reserved.
 //
 
+#include "CompressedSequence.h"
 #include "provided.h"
 
+#include <future>
 #include <iostream>
 #include <istream>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 using namespace std;
 
@@ -21,11 +25,14 @@ public:
   int length() const;
   string name() const;
   bool extract(int position, int length, string &fragment) const;
+  void compress();
 
 private:
   string const m_name;
-  string const m_sequence;
+  string m_sequence; // empty once compressed
   int const m_length;
+  // the compressed sequence, shared by the copies of this genome
+  shared_ptr<CompressedSequence const> m_compressed;
 };
 
 // NOTE: the type of m_length should really be size_t; Unfortunately, the
@@ -35,59 +42,121 @@ GenomeImpl::GenomeImpl(const string &name, const string &sequence)
     : m_name(name), m_sequence(sequence),
       m_length(static_cast<int>(sequence.size())) {}
 
-bool GenomeImpl::load(istream &genomeSource, vector<Genome> &genomes) {
+// Parses genomes out of a source one at a time.
+class GenomeParser {
+public:
+  // read the next genome into name and sequence; false at the end of the
+  // source, or if it is improperly formatted
+  bool next(istream &genomeSource, string &name, string &sequence);
+  bool failed() const { return m_failed; }
+
+private:
+  static bool isValidSequence(const string &line) {
+    for (auto ch : line)
+      if (ch != 'A' && ch != 'T' && ch != 'C' && ch != 'G' && ch != 'N')
+        return false;
+    return true;
+  }
+
   // states:
   // s0 file start
   // s1 was name
   // s2 was genome
-  genomes.clear();
-  int state = 0;
-  string name = "";
-  string seq = "";
+  // s3 file end
+  int m_state = 0;
+  string m_name; // the name of the genome being read
+  bool m_failed = false;
+};
+
+bool GenomeParser::next(istream &genomeSource, string &name,
+                        string &sequence) {
+  sequence.clear();
   string line;
-  while (getline(genomeSource, line)) {
-    switch (state) {
+  while (!m_failed && m_state != 3 && getline(genomeSource, line)) {
+    switch (m_state) {
       case 0:
         if (line.at(0) == '>') {  // name
-          name = line.substr(1);
-          state = 1;
+          m_name = line.substr(1);
+          m_state = 1;
         } else {  // sequence
-          return false;
+          m_failed = true;
         }
         break;
       case 1:
-        if (line.at(0) == '>') {  // name
-          return false;
+        if (line.at(0) == '>' || !isValidSequence(line)) {
+          m_failed = true;
         } else {  // sequence
-          for (auto ch : line)
-            if (ch != 'A' && ch != 'T' && ch != 'C' && ch != 'G' && ch != 'N')
-              return false;
-          seq += line;
-          state = 2;
+          sequence += line;
+          m_state = 2;
         }
         break;
       case 2:
-        if (line.at(0) == '>') {  // name
-          genomes.push_back(Genome(name, seq));
-          name = line.substr(1);
-          seq = "";
-          state = 1;
+        if (line.at(0) == '>') {  // name; the genome is complete
+          name = m_name;
+          m_name = line.substr(1);
+          m_state = 1;
+          return true;
+        } else if (!isValidSequence(line)) {
+          m_failed = true;
         } else {  // sequence
-          for (auto ch : line)
-            if (ch != 'A' && ch != 'T' && ch != 'C' && ch != 'G' && ch != 'N')
-              return false;
-          seq += line;
-          state = 2;
+          sequence += line;
         }
         break;
     }
   }
-  if (!name.empty() && !seq.empty()) {
-    genomes.push_back(Genome(name, seq));
-  }
-  return true;
+  if (m_failed || m_state == 3)
+    return false;
+  bool const complete = m_state == 2 && !m_name.empty() && !sequence.empty();
+  m_state = 3;
+  if (complete)
+    name = m_name;
+  return complete;
+}
+
+bool GenomeImpl::load(istream &genomeSource, vector<Genome> &genomes) {
+  genomes.clear();
+  GenomeParser parser;
+  string name, sequence;
+  while (parser.next(genomeSource, name, sequence))
+    genomes.push_back(Genome(name, sequence));
+  return !parser.failed();
 }
 
+// Parses the next genome on a background thread while the current one is
+// being used.
+class GenomeReaderImpl {
+public:
+  GenomeReaderImpl(istream &genomeSource) : m_source(genomeSource) {
+    parseNext();
+  }
+  bool next(Genome &genome) {
+    if (!m_parsed.valid() || !m_parsed.get())
+      return false;
+    Genome parsed(m_name, m_sequence);
+    genome = move(parsed);
+    parseNext();
+    return true;
+  }
+  bool failed() {
+    // the background parse may be the one that fails
+    if (m_parsed.valid())
+      m_parsed.wait();
+    return m_parser.failed();
+  }
+
+private:
+  void parseNext() {
+    m_parsed = async(launch::async, [this] {
+      return m_parser.next(m_source, m_name, m_sequence);
+    });
+  }
+
+  istream &m_source;
+  GenomeParser m_parser;
+  string m_name, m_sequence; // written by the background parse only
+  future<bool> m_parsed;     // whether the background parse got a genome
+};
+
 int GenomeImpl::length() const { return m_length; }
 
 string GenomeImpl::name() const { return m_name; }
@@ -96,10 +165,22 @@ bool GenomeImpl::extract(int pos, int len, string &fragment) const {
   if (pos + len > length())
     // cannot extract beyond the end of the genome sequence
     return false;
-  fragment = m_sequence.substr(pos, len);
+  if (m_compressed)
+    m_compressed->extract(pos, len, fragment);
+  else
+    // assign in place, so the fragment's buffer can be reused between calls
+    fragment.assign(m_sequence, pos, len);
   return true;
 }
 
+void GenomeImpl::compress() {
+  if (m_compressed)
+    return;
+  m_compressed = make_shared<CompressedSequence const>(m_sequence);
+  // release the uncompressed copy
+  string().swap(m_sequence);
+}
+
 //******************** Genome functions ************************************
 
 // These functions simply delegate to GenomeImpl's functions.
@@ -120,6 +201,11 @@ Genome &Genome::operator=(const Genome &rhs) {
   return *this;
 }
 
+Genome &Genome::operator=(Genome &&rhs) {
+  swap(m_impl, rhs.m_impl);
+  return *this;
+}
+
 bool Genome::load(istream &genomeSource, vector<Genome> &genomes) {
   return GenomeImpl::load(genomeSource, genomes);
 }
@@ -131,3 +217,17 @@ string Genome::name() const { return m_impl->name(); }
 bool Genome::extract(int position, int length, string &fragment) const {
   return m_impl->extract(position, length, fragment);
 }
+
+void Genome::compress() { m_impl->compress(); }
+
+//******************** GenomeReader functions ******************************
+
+GenomeReader::GenomeReader(istream &genomeSource) {
+  m_impl = new GenomeReaderImpl(genomeSource);
+}
+
+GenomeReader::~GenomeReader() { delete m_impl; }
+
+bool GenomeReader::next(Genome &genome) { return m_impl->next(genome); }
+
+bool GenomeReader::failed() const { return m_impl->failed(); }
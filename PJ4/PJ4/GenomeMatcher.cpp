@@ -6,71 +6,363 @@
 //  Copyright © 2019 UCLA. All rights reserved.
 //
 
+#include "BloomFilter.h"
+#include "Kmer.h"
+#include "KmerHash.h"
+#include "LRUCache.h"
+#include "Myers.h"
 #include "Trie.h"
 #include "provided.h"
 
+#include <algorithm>
 #include <fstream>
 #include <iostream>
+#include <memory>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
 using namespace std;
 
+// how much of a query findRelatedGenomes reads at a time (more if a window is
+// longer), so a long query is never held in memory whole
+static const int QUERY_CHUNK_LENGTH = 1 << 16;
+
 class GenomeMatcherImpl {
 public:
-  GenomeMatcherImpl(int minSearchLength);
+  GenomeMatcherImpl(int minSearchLength, const GenomeMatcherOptions &options);
   void addGenome(const Genome &genome);
   int minimumSearchLength() const;
+  size_t resultCacheHits() const { return m_resultCache.hits(); }
+  size_t resultCacheMisses() const { return m_resultCache.misses(); }
   bool findGenomesWithThisDNA(const string &fragment, int minimumLength,
                               bool exactMatchOnly,
                               vector<DNAMatch> &matches) const;
+  bool findGenomesWithThisDNA(const string &fragment, int minimumLength,
+                              bool exactMatchOnly, vector<DNAMatch> &matches,
+                              QueryContext &context) const;
+  bool findAllMatchesOfThisDNA(const string &fragment, int minimumLength,
+                               bool exactMatchOnly,
+                               vector<DNAMatch> &matches) const;
+  bool findGenomesWithinEditDistance(const string &fragment, int maxEdits,
+                                     vector<DNAEditMatch> &matches) const;
   bool findRelatedGenomes(const Genome &query, int fragmentMatchLength,
                           bool exactMatchOnly, double matchPercentThreshold,
                           vector<GenomeMatch> &results) const;
+  bool findRelatedGenomes(const Genome &query, int fragmentMatchLength,
+                          bool exactMatchOnly, double matchPercentThreshold,
+                          int stride, vector<GenomeMatch> &results) const;
 
 private:
+  friend class QueryContextImpl;
   int prefixMatch(string const &a, string const &b,
                   bool const &exactMatchOnly) const;
+  // same as above for the first maxLength chars of a and b
+  int prefixMatch(char const *a, char const *b, int maxLength,
+                  bool exactMatchOnly) const;
+  // best matches first, ties broken by name
+  static void sortGenomeMatches(vector<GenomeMatch> &results);
   // fragment genome into fragmentLength pieces
   vector<string> fragmentGenome(Genome const &genome,
                                 int const &fragmentLength) const;
+  // whether only the minimizers of each genome are indexed
+  bool isSparse() const { return m_options.minimizerWindow > 1; }
+  bool usesBloomFilter() const { return m_options.bloomFilterBitsPerKey > 0; }
+  bool usesResultCache() const { return m_options.resultCacheCapacity > 0; }
+  // find the positions of the keys of the sequence that get indexed
+  void findKeyPositions(string const &sequence,
+                        vector<int> &keyPositions) const;
+  // make room in the Bloom filter for the keys of a new genome
+  void reserveBloomFilter(size_t nNewKeys);
+  // Which of the keys a search for a key tries the Bloom filter rules out:
+  // the key itself, and each key with one base of it changed, as the index
+  // asks for them while it walks (see Trie::findSNiPs). Changed bases are
+  // given by their index in "ACGTN" (see DNA5Alphabet).
+  class BloomPruning {
+  public:
+    BloomPruning(BloomFilter const &filter, string const &key)
+        : m_filter(filter), m_key(&key),
+          m_keyLength(static_cast<int>(key.size())) {
+      m_isPacked = packKmer(key, m_code);
+    }
+    // for a key of keyLength bases packed into code
+    BloomPruning(BloomFilter const &filter, uint64_t code, int keyLength)
+        : m_filter(filter), m_key(nullptr), m_code(code), m_isPacked(true),
+          m_keyLength(keyLength) {}
+    bool skipsKey() const {
+      return !m_filter.mayContain(m_isPacked ? mixHash(m_code)
+                                             : hashKmer(*m_key));
+    }
+    bool skipsSNiP(size_t depth, int index) const;
+
+  private:
+    BloomFilter const &m_filter;
+    string const *m_key; // null if only the code is known
+    uint64_t m_code = 0;
+    bool m_isPacked;
+    int m_keyLength;
+    mutable string m_neighbor; // the key, to change bases of that won't pack
+  };
   class GenomeRef {
   public:
     GenomeRef(int const &index, int const &keyPosition)
         : m_index(index), m_position(keyPosition) {}
     int index() const { return m_index; }
     int position() const { return m_position; }
+    bool operator<(GenomeRef const &other) const {
+      return m_index != other.m_index ? m_index < other.m_index
+                                      : m_position < other.m_position;
+    }
+    bool operator==(GenomeRef const &other) const {
+      return m_index == other.m_index && m_position == other.m_position;
+    }
 
   private:
     int m_index;    // genome name
     int m_position; // position of the searchKey in the genome
   };
+  // the index from K-char keys to the positions they occur at in the library
+  class KmerIndex {
+  public:
+    virtual ~KmerIndex() {}
+    virtual void insert(const string &key, const GenomeRef &ref) = 0;
+    // index the keys of the genome at the given library index that start at
+    // keyPositions (in increasing order)
+    virtual void insertGenome(int index, const string &sequence,
+                              const vector<int> &keyPositions, int keyLength) {
+      for (int const keyPos : keyPositions)
+        insert(sequence.substr(keyPos, keyLength), GenomeRef(index, keyPos));
+    }
+    // append the refs indexed by the key, or by the key with one mismatch
+    // (anywhere but the first char) if not exactMatchOnly, to found; leave
+    // out the keys pruning rules out, if given
+    virtual void find(const string &key, bool exactMatchOnly,
+                      BloomPruning const *pruning,
+                      vector<GenomeRef> &found) const = 0;
+    // whether keys can be looked up by their packed codes alone, below
+    virtual bool findsByCode() const { return false; }
+    // same as above, for a key of keyLength bases packed into code (see
+    // Kmer.h); only for an index that findsByCode()
+    virtual void find(uint64_t /* code */, int /* keyLength */,
+                      bool /* exactMatchOnly */,
+                      BloomPruning const * /* pruning */,
+                      vector<GenomeRef> & /* found */) const {}
+  };
+  class TrieIndex : public KmerIndex {
+  public:
+    TrieIndex(const ArenaOptions &arenaOptions) : m_trie(arenaOptions) {}
+    virtual void insert(const string &key, const GenomeRef &ref) {
+      m_trie.insert(key, ref);
+    }
+    virtual void insertGenome(int index, const string &sequence,
+                              const vector<int> &keyPositions, int keyLength);
+    virtual void find(const string &key, bool exactMatchOnly,
+                      BloomPruning const *pruning,
+                      vector<GenomeRef> &found) const {
+      if (exactMatchOnly || pruning == nullptr)
+        m_trie.find(key, exactMatchOnly, found);
+      else
+        m_trie.findSNiPs(key, *pruning, found);
+    }
+
+  private:
+    Trie<GenomeRef, DNA5Alphabet> m_trie;
+  };
+  // only usable when K <= 32; keys containing N are not indexed
+  class HashIndex : public KmerIndex {
+  public:
+    virtual void insert(const string &key, const GenomeRef &ref);
+    virtual void find(const string &key, bool exactMatchOnly,
+                      BloomPruning const *pruning,
+                      vector<GenomeRef> &found) const;
+    virtual bool findsByCode() const { return true; }
+    virtual void find(uint64_t code, int keyLength, bool exactMatchOnly,
+                      BloomPruning const *pruning,
+                      vector<GenomeRef> &found) const;
+
+  private:
+    KmerHashTable<GenomeRef> m_table;
+  };
+  // find the genome positions where a match of the fragment may start
+  void findCandidates(string const &fragment, int minimumLength,
+                      bool exactMatchOnly,
+                      vector<GenomeRef> &candidateRefs) const;
+  // same as above, using key as scratch space
+  void findCandidates(string const &fragment, int minimumLength,
+                      bool exactMatchOnly, vector<GenomeRef> &candidateRefs,
+                      string &key) const;
+  // append the refs indexed by the key (or by the key with one mismatch if
+  // not exactMatchOnly) to refs, but for the keys the Bloom filter rules out
+  void findKeyRefs(string const &key, bool exactMatchOnly,
+                   vector<GenomeRef> &refs) const;
+  // same as above, for a key packed into code; only if the index
+  // findsByCode()
+  void findKeyRefs(uint64_t code, bool exactMatchOnly,
+                   vector<GenomeRef> &refs) const;
   int const m_minimumSearchLength; // will be referred to as K in comments
-  Trie<GenomeRef> m_trie;
+  GenomeMatcherOptions const m_options;
+  unique_ptr<KmerIndex> m_index;
+  BloomFilter m_bloomFilter; // over every indexed key
   vector<Genome> m_library;
+  // genomes sharing a name are reported as one; each distinct name gets an id
+  unordered_map<string, int> m_nameIds;
+  vector<string> m_names;          // the name of each id
+  vector<int> m_nameIdOfGenome;    // the name id of each library genome
+  // findGenomesWithThisDNA results, keyed by their parameters and fragment
+  mutable LRUCache<string, vector<DNAMatch>> m_resultCache;
 };
 
-GenomeMatcherImpl::GenomeMatcherImpl(int minSearchLength)
-    : m_minimumSearchLength(minSearchLength) {}
+// The scratch buffers of a QueryContext; they are cleared, never freed,
+// between queries so their capacity carries over.
+class QueryContextImpl {
+public:
+  vector<GenomeMatcherImpl::GenomeRef> candidateRefs;
+  string key;
+  string candidateSegment;
+  string cacheKey;
+  vector<int> matchOfName; // where each name's match is in the results, or -1
+};
+
+GenomeMatcherImpl::GenomeMatcherImpl(int minSearchLength,
+                                     const GenomeMatcherOptions &options)
+    : m_minimumSearchLength(minSearchLength), m_options(options),
+      m_resultCache(options.resultCacheCapacity) {
+  // the hash index packs each key into 64 bits, so it cannot hold long keys
+  if (options.indexBackend == GenomeMatcherOptions::hashIndex &&
+      minSearchLength <= MAX_PACKED_KMER_LENGTH)
+    m_index.reset(new HashIndex());
+  else {
+    ArenaOptions arenaOptions;
+    arenaOptions.hugePages = options.hugePages;
+    arenaOptions.prefault = options.prefaultIndex;
+    m_index.reset(new TrieIndex(arenaOptions));
+  }
+}
 
 void GenomeMatcherImpl::addGenome(const Genome &genome) {
   int const index = static_cast<int>(m_library.size());
   m_library.push_back(genome);
-  // iterate through every substring of length minSearchLength().
-  // Each such substring will be used as a key to find this genome in the trie
-  // genome index.
+  auto const nameId =
+      m_nameIds.emplace(genome.name(), static_cast<int>(m_names.size()));
+  if (nameId.second)
+    m_names.push_back(genome.name());
+  m_nameIdOfGenome.push_back(nameId.first->second);
+  // cached results may miss matches in the new genome
+  m_resultCache.clear();
+  string sequence;
+  genome.extract(0, genome.length(), sequence);
+  vector<int> keyPositions;
+  findKeyPositions(sequence, keyPositions);
+  if (usesBloomFilter())
+    reserveBloomFilter(keyPositions.size());
+  int const keyLength = minimumSearchLength();
+  // index the genome's references, which contain the genome's index and
+  // the index keys' positions in the genome
+  m_index->insertGenome(index, sequence, keyPositions, keyLength);
+  if (usesBloomFilter())
+    for (int const keyPos : keyPositions)
+      m_bloomFilter.insert(hashKmer(sequence.substr(keyPos, keyLength)));
+  if (m_options.compressGenomes)
+    m_library.back().compress();
+}
+
+void GenomeMatcherImpl::TrieIndex::insertGenome(int index,
+                                                const string &sequence,
+                                                const vector<int> &keyPositions,
+                                                int keyLength) {
+  if (keyLength > MAX_PACKED_KMER_LENGTH) {
+    KmerIndex::insertGenome(index, sequence, keyPositions, keyLength);
+    return;
+  }
+  // Inserting the keys in genome order jumps all over the trie. Instead,
+  // pack the keys, radix sort them, and insert them in sorted order, so the
+  // trie is walked sequentially and each key's refs are added at once.
+  vector<pair<uint64_t, int>> packedKeys; // (code, key position)
+  packedKeys.reserve(keyPositions.size());
   string key;
+  for (int const keyPos : keyPositions) {
+    key.assign(sequence, keyPos, keyLength);
+    uint64_t code;
+    if (packKmer(key, code))
+      packedKeys.emplace_back(code, keyPos);
+    else
+      m_trie.insert(key, GenomeRef(index, keyPos)); // contains N
+  }
+  radixSortByCode(packedKeys, 2 * keyLength);
+  Trie<GenomeRef, DNA5Alphabet>::SortedInserter inserter(m_trie);
+  vector<GenomeRef> refs;
+  for (size_t first = 0; first < packedKeys.size();) {
+    uint64_t const code = packedKeys[first].first;
+    refs.clear();
+    for (; first < packedKeys.size() && packedKeys[first].first == code;
+         first++)
+      refs.push_back(GenomeRef(index, packedKeys[first].second));
+    unpackKmer(code, keyLength, key);
+    inserter.insert(key, refs.data(), refs.size());
+  }
+}
+
+void GenomeMatcherImpl::findKeyPositions(string const &sequence,
+                                         vector<int> &keyPositions) const {
+  int const keyLength = minimumSearchLength();
+  if (isSparse()) {
+    // only index the (w,k)-minimizers; any other occurrence of a window of w
+    // consecutive keys picks the same key as its minimizer, at the same offset
+    findMinimizers(sequence, keyLength, m_options.minimizerWindow,
+                   keyPositions);
+    return;
+  }
+  // every substring of length minSearchLength() will be used as a key to find
+  // this genome in the genome index.
+  keyPositions.clear();
+  int const sequenceLength = static_cast<int>(sequence.size());
+  for (int keyPos = 0; keyPos + keyLength < sequenceLength; keyPos++)
+    keyPositions.push_back(keyPos);
+}
+
+void GenomeMatcherImpl::reserveBloomFilter(size_t nNewKeys) {
+  if (m_bloomFilter.size() + nNewKeys <= m_bloomFilter.capacity())
+    return;
+  // the filter cannot grow in place, so double its capacity and re-insert the
+  // keys of the genomes indexed so far (the newest one is inserted by the
+  // caller)
+  size_t const capacity =
+      max(2 * m_bloomFilter.capacity(), m_bloomFilter.size() + nNewKeys);
+  m_bloomFilter.reset(capacity, m_options.bloomFilterBitsPerKey);
   int const keyLength = minimumSearchLength();
-  for (int keyPos = 0; keyPos + keyLength < genome.length(); keyPos++) {
-    // extract the key
-    genome.extract(keyPos, keyLength, key);
-    // index the genome's reference, which contains the genome's name and
-    // the index key's position in the genome
-    m_trie.insert(key, GenomeRef(index, keyPos));
+  string sequence;
+  vector<int> keyPositions;
+  for (size_t i = 0; i + 1 < m_library.size(); i++) {
+    m_library[i].extract(0, m_library[i].length(), sequence);
+    findKeyPositions(sequence, keyPositions);
+    for (int const keyPos : keyPositions)
+      m_bloomFilter.insert(hashKmer(sequence.substr(keyPos, keyLength)));
   }
 }
 
+bool GenomeMatcherImpl::BloomPruning::skipsSNiP(size_t depth,
+                                                int index) const {
+  // the hash of a packable key is its mixed code (see hashKmer), so a
+  // neighbor of a packed key is hashed by changing two bits of the code
+  if (m_isPacked && index < 4) {
+    int const shift = 2 * (m_keyLength - 1 - static_cast<int>(depth));
+    uint64_t const original = (m_code >> shift) & 3;
+    uint64_t const base = static_cast<uint64_t>(index);
+    return !m_filter.mayContain(mixHash(m_code ^ ((original ^ base) << shift)));
+  }
+  if (m_neighbor.empty()) {
+    if (m_key != nullptr)
+      m_neighbor = *m_key;
+    else
+      unpackKmer(m_code, m_keyLength, m_neighbor);
+  }
+  char const original = m_neighbor[depth];
+  m_neighbor[depth] = "ACGTN"[index];
+  bool const skips = !m_filter.mayContain(hashKmer(m_neighbor));
+  m_neighbor[depth] = original;
+  return skips;
+}
+
 int GenomeMatcherImpl::minimumSearchLength() const {
   return m_minimumSearchLength;
 }
@@ -78,62 +370,262 @@ int GenomeMatcherImpl::minimumSearchLength() const {
 bool GenomeMatcherImpl::findGenomesWithThisDNA(
     const string &fragment, int minimumLength, bool exactMatchOnly,
     vector<DNAMatch> &matches) const {
+  // callers without a context of their own share one per thread
+  thread_local QueryContext context;
+  return findGenomesWithThisDNA(fragment, minimumLength, exactMatchOnly,
+                                matches, context);
+}
+
+bool GenomeMatcherImpl::findGenomesWithThisDNA(
+    const string &fragment, int minimumLength, bool exactMatchOnly,
+    vector<DNAMatch> &matches, QueryContext &context) const {
   int const fragmentLength = static_cast<int>(fragment.size());
   if (fragmentLength < minimumLength)
     return false;
   if (minimumLength < minimumSearchLength())
     return false;
-  matches.clear();
-  // use the first K-chars substring of the fragment as the key to search the
-  // trie index, which gives us a collection of candidate genomes.
-  // These candidates contains a K-char segment which matches first K-char
-  // substring of the given fragment.
-  string const key = fragment.substr(0, minimumSearchLength());
-  vector<GenomeRef> candidateRefs = m_trie.find(key, exactMatchOnly);
-  // filter these candidates
-  unordered_map<string, DNAMatch> matchRecords;
-  for (auto candidateRef : candidateRefs) {
-    Genome const candidateGenome = m_library.at(candidateRef.index());
+  QueryContextImpl &scratch = *context.m_impl;
+  string &cacheKey = scratch.cacheKey;
+  if (usesResultCache()) {
+    cacheKey = to_string(minimumLength);
+    cacheKey += exactMatchOnly ? '=' : '~';
+    cacheKey += fragment;
+    if (m_resultCache.get(cacheKey, matches))
+      return !matches.empty();
+  }
+  vector<GenomeRef> &candidateRefs = scratch.candidateRefs;
+  findCandidates(fragment, minimumLength, exactMatchOnly, candidateRefs,
+                 scratch.key);
+  // filter these candidates, keeping the longest match under each name;
+  // the slots of matches are overwritten rather than cleared, so their
+  // strings keep their buffers
+  vector<int> &matchOfName = scratch.matchOfName;
+  matchOfName.assign(m_names.size(), -1);
+  size_t nMatches = 0;
+  string &candidateSegment = scratch.candidateSegment;
+  for (auto const &candidateRef : candidateRefs) {
+    Genome const &candidateGenome = m_library[candidateRef.index()];
     int const matchPosition = candidateRef.position();
-    // get a segment that matches the length of the given fragment
-    // starting from the key matching position
-    string candidateSegment;
     // Notice that it is possible the tail length of the genome starting from
     // the match position is shorter than the fragment length.
     int const remainingLength = candidateGenome.length() - matchPosition;
     if (remainingLength < minimumLength)
       // the remaining Length is simply not long enough
       continue;
+    // get a segment that matches the length of the given fragment
+    // starting from the key matching position
     int const candidateSegmentLength = min(remainingLength, fragmentLength);
     candidateGenome.extract(matchPosition, candidateSegmentLength,
                             candidateSegment);
     // match the longest prefix between candidateSegment and fragment
     int const matchedLength =
-        prefixMatch(candidateSegment, fragment, exactMatchOnly);
-    // if the matched prefix is long enough (greater than minimumLength)
-    if (matchedLength >= minimumLength) {
+        prefixMatch(candidateSegment.data(), fragment.data(),
+                    candidateSegmentLength, exactMatchOnly);
+    // if the matched prefix is not long enough (less than minimumLength)
+    if (matchedLength < minimumLength)
+      continue;
+    int const nameId = m_nameIdOfGenome[candidateRef.index()];
+    int &slot = matchOfName[nameId];
+    if (slot < 0) {
+      // this is the first segment under this name that matches the given
+      // fragment
+      slot = static_cast<int>(nMatches++);
+      if (matches.size() < nMatches)
+        matches.emplace_back();
+      matches[slot].genomeName = m_names[nameId];
+    } else if (matches[slot].length >= matchedLength)
+      // there is already a segment under this name that matches the given
+      // fragment at least as long
+      continue;
+    matches[slot].length = matchedLength;
+    matches[slot].position = matchPosition;
+    matches[slot].fragmentPosition = 0;
+  }
+  matches.resize(nMatches);
+  sort(matches.begin(), matches.end(),
+       [](DNAMatch const &a, DNAMatch const &b) {
+         return a.genomeName < b.genomeName;
+       });
+  if (usesResultCache())
+    m_resultCache.put(cacheKey, matches);
+  return !matches.empty();
+}
+
+bool GenomeMatcherImpl::findAllMatchesOfThisDNA(
+    const string &fragment, int minimumLength, bool exactMatchOnly,
+    vector<DNAMatch> &matches) const {
+  int const fragmentLength = static_cast<int>(fragment.size());
+  if (fragmentLength < minimumLength)
+    return false;
+  if (minimumLength < minimumSearchLength())
+    return false;
+  matches.clear();
+  int const keyLength = minimumSearchLength();
+  // a match may start anywhere in the fragment, so look up the key at every
+  // offset (only the minimizers of the fragment with a sparse index, which
+  // are looked up exactly as in findCandidates)
+  vector<int> keyOffsets;
+  if (isSparse())
+    findMinimizers(fragment, keyLength, m_options.minimizerWindow, keyOffsets);
+  else
+    for (int keyOffset = 0; keyOffset + keyLength <= fragmentLength;
+         keyOffset++)
+      keyOffsets.push_back(keyOffset);
+  // every hit is turned into the genome position the fragment would start at
+  // for the hit to line up (its diagonal), which may be before the genome
+  vector<GenomeRef> diagonals, keyRefs;
+  string key;
+  for (int const keyOffset : keyOffsets) {
+    key.assign(fragment, keyOffset, keyLength);
+    keyRefs.clear();
+    findKeyRefs(key, exactMatchOnly || isSparse(), keyRefs);
+    for (auto const &ref : keyRefs)
+      diagonals.push_back(GenomeRef(ref.index(), ref.position() - keyOffset));
+  }
+  sort(diagonals.begin(), diagonals.end());
+  diagonals.erase(unique(diagonals.begin(), diagonals.end()), diagonals.end());
+  // one pass over the sorted diagonals: each is compared base by base once,
+  // and the stretch where the fragment and the genome overlap is cut at its
+  // mismatches into maximal intervals
+  string segment;
+  vector<int> mismatches;
+  size_t genomeMatchesStart = 0;
+  for (size_t d = 0; d < diagonals.size(); d++) {
+    Genome const &genome = m_library[diagonals[d].index()];
+    int const shift = diagonals[d].position();
+    int const begin = max(0, -shift);
+    int const end = min(fragmentLength, genome.length() - shift);
+    genome.extract(shift + begin, end - begin, segment);
+    // the mismatches, between the positions just outside the overlap
+    mismatches.assign(1, begin - 1);
+    for (int i = begin; i < end; i++)
+      if (segment[i - begin] != fragment[i])
+        mismatches.push_back(i);
+    mismatches.push_back(end);
+    auto report = [&](int start, int stop) {
+      if (stop - start < minimumLength)
+        return;
       DNAMatch match;
-      match.genomeName = candidateGenome.name();
-      match.length = matchedLength;
-      match.position = matchPosition;
-      // check if there is already a segment in this genome that matches
-      // this fragment
-      if (matchRecords.find(candidateGenome.name()) == matchRecords.end())
-        // this is the first segment in this genome that matches the
-        // given fragment; store this match
-        matchRecords.emplace(candidateGenome.name(), match);
-      else {
-        // there is already a segment in this genome that matches the
-        // given fragment; in this case, store the longer segment match
-        DNAMatch existingMatch = matchRecords.at(candidateGenome.name());
-        if (existingMatch.length < matchedLength)
-          matchRecords[candidateGenome.name()] = match;
+      match.genomeName = genome.name();
+      match.length = stop - start;
+      match.position = shift + start;
+      match.fragmentPosition = start;
+      matches.push_back(match);
+    };
+    size_t const nMismatches = mismatches.size() - 2;
+    if (exactMatchOnly || nMismatches == 0) {
+      // an exact match lies between two consecutive mismatches
+      for (size_t j = 0; j <= nMismatches; j++)
+        report(mismatches[j] + 1, mismatches[j + 1]);
+    } else {
+      // a match with a SNiP spans mismatch j, from the one before it to the
+      // one after it, but must start on a matching base; if it cannot, the
+      // bases after the last mismatch are left as a match of their own
+      for (size_t j = 1; j <= nMismatches; j++) {
+        if (mismatches[j - 1] + 1 < mismatches[j])
+          report(mismatches[j - 1] + 1, mismatches[j + 1]);
+        else if (j == nMismatches)
+          report(mismatches[j] + 1, mismatches[j + 1]);
       }
     }
+    // the matches of a genome are reported in increasing position
+    if (d + 1 == diagonals.size() ||
+        diagonals[d + 1].index() != diagonals[d].index()) {
+      sort(matches.begin() + genomeMatchesStart, matches.end(),
+           [](DNAMatch const &a, DNAMatch const &b) {
+             return a.position != b.position
+                        ? a.position < b.position
+                        : a.fragmentPosition < b.fragmentPosition;
+           });
+      genomeMatchesStart = matches.size();
+    }
+  }
+  return !matches.empty();
+}
+
+bool GenomeMatcherImpl::findGenomesWithinEditDistance(
+    const string &fragment, int maxEdits,
+    vector<DNAEditMatch> &matches) const {
+  int const fragmentLength = static_cast<int>(fragment.size());
+  if (maxEdits < 0)
+    return false;
+  // cut the fragment into maxEdits + 1 pieces; a match with at most maxEdits
+  // edits leaves at least one of them intact, so exact hits of the pieces
+  // seed every match. The sparse index only finds every exact hit of a piece
+  // that holds a whole window of w keys.
+  int const nPieces = maxEdits + 1;
+  int const pieceLength = fragmentLength / nPieces;
+  int const minimumPieceLength =
+      isSparse() ? m_options.minimizerWindow + minimumSearchLength() - 1
+                 : minimumSearchLength();
+  if (pieceLength < minimumPieceLength)
+    return false;
+  matches.clear();
+  // the stretches of each genome a match may lie in
+  struct Window {
+    int index, begin, end;
+  };
+  vector<Window> windows;
+  vector<GenomeRef> seedRefs;
+  string piece;
+  for (int i = 0; i < nPieces; i++) {
+    int const pieceStart = i * pieceLength;
+    piece.assign(fragment, pieceStart, pieceLength);
+    findCandidates(piece, pieceLength, true, seedRefs);
+    for (auto const &seedRef : seedRefs) {
+      // the match would start near where the fragment start lines up with
+      // the seed, give or take maxEdits indels
+      int const matchStart = seedRef.position() - pieceStart;
+      int const genomeLength = m_library[seedRef.index()].length();
+      windows.push_back({seedRef.index(), max(0, matchStart - maxEdits),
+                         min(genomeLength,
+                             matchStart + fragmentLength + maxEdits)});
+    }
+  }
+  sort(windows.begin(), windows.end(), [](Window const &a, Window const &b) {
+    return a.index != b.index ? a.index < b.index : a.begin < b.begin;
+  });
+  // merge the overlapping windows of each genome
+  size_t nMerged = 0;
+  for (auto const &window : windows) {
+    if (nMerged > 0 && windows[nMerged - 1].index == window.index &&
+        window.begin <= windows[nMerged - 1].end)
+      windows[nMerged - 1].end = max(windows[nMerged - 1].end, window.end);
+    else
+      windows[nMerged++] = window;
+  }
+  windows.resize(nMerged);
+  MyersPattern const pattern(fragment);
+  MyersPattern const reversedPattern(
+      string(fragment.rbegin(), fragment.rend()));
+  string text, reversedText;
+  int lastMatchedIndex = -1; // the genome of matches.back()
+  for (auto const &window : windows) {
+    Genome const &genome = m_library[window.index];
+    genome.extract(window.begin, window.end - window.begin, text);
+    int matchEnd;
+    int const editDistance =
+        pattern.search(text.data(), static_cast<int>(text.size()), matchEnd);
+    if (editDistance > maxEdits)
+      continue;
+    // the scan only tells where the best match ends; align the reversed
+    // fragment backwards from there to find where it starts
+    reversedText.assign(text.rbegin() + (text.size() - matchEnd),
+                        text.rend());
+    int matchLength;
+    reversedPattern.align(reversedText.data(), matchEnd, matchLength);
+    DNAEditMatch match;
+    match.genomeName = genome.name();
+    match.length = matchLength;
+    match.position = window.begin + matchEnd - matchLength;
+    match.editDistance = editDistance;
+    // keep the closest match of each genome, the leftmost among ties
+    if (lastMatchedIndex != window.index) {
+      matches.push_back(match);
+      lastMatchedIndex = window.index;
+    } else if (editDistance < matches.back().editDistance)
+      matches.back() = match;
   }
-  for (auto const &pair : matchRecords)
-    // store the all the matches found
-    matches.push_back(pair.second);
   return !matches.empty();
 }
 
@@ -175,9 +667,241 @@ bool GenomeMatcherImpl::findRelatedGenomes(const Genome &query,
       results.push_back(genomeMatch);
     }
   }
+  sortGenomeMatches(results);
+  return !results.empty();
+}
+
+void GenomeMatcherImpl::sortGenomeMatches(vector<GenomeMatch> &results) {
+  sort(results.begin(), results.end(),
+       [](GenomeMatch const &a, GenomeMatch const &b) {
+         if (a.percentMatch != b.percentMatch)
+           return a.percentMatch > b.percentMatch;
+         return a.genomeName < b.genomeName;
+       });
+}
+
+bool GenomeMatcherImpl::findRelatedGenomes(const Genome &query,
+                                           int fragmentMatchLength,
+                                           bool exactMatchOnly,
+                                           double matchPercentThreshold,
+                                           int stride,
+                                           vector<GenomeMatch> &results) const {
+  if (fragmentMatchLength < minimumSearchLength() || stride < 1)
+    return false;
+  results.clear();
+  int const queryLength = query.length();
+  int const windowLength = fragmentMatchLength;
+  int const keyLength = minimumSearchLength();
+  // the part of the query read so far, which always holds the whole window
+  string chunk;
+  int chunkStart = 0, chunkEnd = 0;
+  int const chunkLength = max(windowLength, QUERY_CHUNK_LENGTH);
+  // the number of windows matched under each name, and the last one matched
+  vector<int> nMatchedWindows(m_names.size(), 0);
+  vector<int> lastMatchedWindow(m_names.size(), -1);
+  // scratch space reused by every window
+  vector<GenomeRef> candidateRefs;
+  string key, window, candidateSegment;
+  // in the dense index, a window's candidates are found by its first K bases;
+  // an index that looks keys up by code gets them rolled into a 2-bit code,
+  // rather than copied out and re-packed every time
+  bool const rollsKeys = !isSparse() && keyLength <= MAX_PACKED_KMER_LENGTH &&
+                         m_index->findsByCode();
+  uint64_t const keyMask = keyLength == MAX_PACKED_KMER_LENGTH
+                               ? ~uint64_t(0)
+                               : (uint64_t(1) << (2 * keyLength)) - 1;
+  uint64_t code = 0;
+  int nextBase = 0;     // the next base to roll into the code
+  int lastUnknown = -1; // the last position of a base that cannot be packed
+  int nWindows = 0;
+  for (int start = 0; start + windowLength <= queryLength;
+       start += stride, nWindows++) {
+    if (start + windowLength > chunkEnd) {
+      chunkStart = start;
+      query.extract(chunkStart, min(chunkLength, queryLength - chunkStart),
+                    chunk);
+      chunkEnd = chunkStart + static_cast<int>(chunk.size());
+    }
+    char const *windowBases = chunk.data() + (start - chunkStart);
+    candidateRefs.clear();
+    if (rollsKeys) {
+      // bases before the window start fall out of the mask on their own
+      nextBase = max(nextBase, start);
+      for (; nextBase < start + keyLength; nextBase++) {
+        int bits = baseCode(chunk[nextBase - chunkStart]);
+        if (bits < 0) {
+          lastUnknown = nextBase;
+          bits = 0;
+        }
+        code = ((code << 2) | static_cast<uint64_t>(bits)) & keyMask;
+      }
+      if (lastUnknown < start) {
+        findKeyRefs(code, exactMatchOnly, candidateRefs);
+      } else {
+        // an N in the key; only the string lookup knows what to do with it
+        key.assign(windowBases, keyLength);
+        findKeyRefs(key, exactMatchOnly, candidateRefs);
+      }
+    } else {
+      window.assign(windowBases, windowLength);
+      findCandidates(window, windowLength, exactMatchOnly, candidateRefs);
+    }
+    for (auto const &candidateRef : candidateRefs) {
+      int const nameId = m_nameIdOfGenome[candidateRef.index()];
+      if (lastMatchedWindow[nameId] == nWindows)
+        continue; // already matched by another segment
+      Genome const &candidateGenome = m_library[candidateRef.index()];
+      if (candidateGenome.length() - candidateRef.position() < windowLength)
+        continue;
+      candidateGenome.extract(candidateRef.position(), windowLength,
+                              candidateSegment);
+      if (prefixMatch(candidateSegment.data(), windowBases, windowLength,
+                      exactMatchOnly) == windowLength) {
+        nMatchedWindows[nameId]++;
+        lastMatchedWindow[nameId] = nWindows;
+      }
+    }
+  }
+  for (size_t nameId = 0; nameId < m_names.size(); nameId++) {
+    int const nMatched = nMatchedWindows[nameId];
+    if (nMatched == 0)
+      continue;
+    double const windowMatchPercentage = 100.0 * nMatched / nWindows;
+    if (windowMatchPercentage >= matchPercentThreshold) {
+      GenomeMatch genomeMatch;
+      genomeMatch.genomeName = m_names[nameId];
+      genomeMatch.percentMatch = windowMatchPercentage;
+      results.push_back(genomeMatch);
+    }
+  }
+  sortGenomeMatches(results);
   return !results.empty();
 }
 
+void GenomeMatcherImpl::findKeyRefs(string const &key, bool exactMatchOnly,
+                                    vector<GenomeRef> &refs) const {
+  if (!usesBloomFilter()) {
+    m_index->find(key, exactMatchOnly, nullptr, refs);
+    return;
+  }
+  BloomPruning const pruning(m_bloomFilter, key);
+  if (!exactMatchOnly)
+    m_index->find(key, false, &pruning, refs);
+  else if (!pruning.skipsKey())
+    m_index->find(key, true, nullptr, refs);
+}
+
+void GenomeMatcherImpl::findKeyRefs(uint64_t code, bool exactMatchOnly,
+                                    vector<GenomeRef> &refs) const {
+  int const keyLength = minimumSearchLength();
+  if (!usesBloomFilter()) {
+    m_index->find(code, keyLength, exactMatchOnly, nullptr, refs);
+    return;
+  }
+  BloomPruning const pruning(m_bloomFilter, code, keyLength);
+  if (!exactMatchOnly)
+    m_index->find(code, keyLength, false, &pruning, refs);
+  else if (!pruning.skipsKey())
+    m_index->find(code, keyLength, true, nullptr, refs);
+}
+
+void GenomeMatcherImpl::findCandidates(string const &fragment,
+                                       int minimumLength, bool exactMatchOnly,
+                                       vector<GenomeRef> &candidateRefs) const {
+  string key;
+  findCandidates(fragment, minimumLength, exactMatchOnly, candidateRefs, key);
+}
+
+void GenomeMatcherImpl::findCandidates(string const &fragment,
+                                       int minimumLength, bool exactMatchOnly,
+                                       vector<GenomeRef> &candidateRefs,
+                                       string &key) const {
+  int const keyLength = minimumSearchLength();
+  candidateRefs.clear();
+  if (!isSparse()) {
+    // use the first K-chars substring of the fragment as the key to search
+    // the index, which gives us a collection of candidate genomes.
+    // These candidates contains a K-char segment which matches first K-char
+    // substring of the given fragment.
+    key.assign(fragment, 0, keyLength);
+    findKeyRefs(key, exactMatchOnly, candidateRefs);
+    return;
+  }
+  // a match must cover the first minimumLength chars of the fragment, so every
+  // minimizer of that region that avoids the SNiP is indexed at the same
+  // offset from the start of the matching segment
+  string const region = fragment.substr(0, minimumLength);
+  vector<int> keyOffsets;
+  findMinimizers(region, keyLength, m_options.minimizerWindow, keyOffsets);
+  vector<GenomeRef> keyRefs;
+  for (int const keyOffset : keyOffsets) {
+    key.assign(region, keyOffset, keyLength);
+    keyRefs.clear();
+    findKeyRefs(key, true, keyRefs);
+    for (auto const &ref : keyRefs)
+      if (ref.position() >= keyOffset)
+        candidateRefs.push_back(
+            GenomeRef(ref.index(), ref.position() - keyOffset));
+  }
+  // several minimizers may point to the same segment start
+  sort(candidateRefs.begin(), candidateRefs.end());
+  candidateRefs.erase(unique(candidateRefs.begin(), candidateRefs.end()),
+                      candidateRefs.end());
+}
+
+void GenomeMatcherImpl::HashIndex::insert(const string &key,
+                                          const GenomeRef &ref) {
+  uint64_t code;
+  if (packKmer(key, code))
+    m_table.insert(code, ref);
+}
+
+void GenomeMatcherImpl::HashIndex::find(const string &key, bool exactMatchOnly,
+                                        BloomPruning const *pruning,
+                                        vector<GenomeRef> &found) const {
+  uint64_t code;
+  if (packKmer(key, code)) {
+    find(code, static_cast<int>(key.size()), exactMatchOnly, pruning, found);
+    return;
+  }
+  // a key with exactly one N (not the first char) can still SNiP-match on the
+  // N; no indexed key contains N, so nothing else can match
+  size_t const unknown = key.find_first_not_of("ACGT");
+  if (exactMatchOnly || unknown == 0 || unknown == string::npos ||
+      key.find_first_not_of("ACGT", unknown + 1) != string::npos)
+    return;
+  string neighbor = key;
+  for (int base = 0; base < 4; base++) {
+    if (pruning != nullptr && pruning->skipsSNiP(unknown, base))
+      continue;
+    neighbor[unknown] = "ACGT"[base];
+    if (packKmer(neighbor, code))
+      m_table.find(code, found);
+  }
+}
+
+void GenomeMatcherImpl::HashIndex::find(uint64_t code, int keyLength,
+                                        bool exactMatchOnly,
+                                        BloomPruning const *pruning,
+                                        vector<GenomeRef> &found) const {
+  if (pruning == nullptr || !pruning->skipsKey())
+    m_table.find(code, found);
+  if (exactMatchOnly)
+    return;
+  // probe the 3(K-1) codes that differ from the key in exactly one base,
+  // the first base excepted
+  for (int i = 1; i < keyLength; i++) {
+    int const shift = 2 * (keyLength - 1 - i);
+    uint64_t const original = (code >> shift) & 3;
+    for (uint64_t base = 0; base < 4; base++) {
+      if (base == original || (pruning != nullptr &&
+                               pruning->skipsSNiP(i, static_cast<int>(base))))
+        continue;
+      m_table.find(code ^ ((original ^ base) << shift), found);
+    }
+  }
+}
+
 vector<string> GenomeMatcherImpl::fragmentGenome(Genome const &genome,
                                   int const &fragmentLength) const {
   vector<string> fragments;
@@ -192,12 +916,19 @@ vector<string> GenomeMatcherImpl::fragmentGenome(Genome const &genome,
 
 int GenomeMatcherImpl::prefixMatch(string const &a, string const &b,
                                    bool const &exactMatchOnly) const {
-  if (a.size() == 0 || b.size() == 0)
+  // matching prefix cannot be longer then the shorter string
+  return prefixMatch(a.data(), b.data(),
+                     static_cast<int>(min(a.size(), b.size())),
+                     exactMatchOnly);
+}
+
+int GenomeMatcherImpl::prefixMatch(char const *a, char const *b,
+                                   int maxMatchLength,
+                                   bool exactMatchOnly) const {
+  if (maxMatchLength == 0)
     return 0;
   if (a[0] != b[0])
     return 0;
-  int const maxMatchLength = static_cast<int>(min(a.size(), b.size()));
-  // matching prefix cannot be longer then the shorter string
   bool SNiPed = exactMatchOnly ? true : false;
   // if not exactMatchOnly, the prefix has one chance to mismatch; otherwise,
   // there is no chance for SNiP at all.
@@ -212,13 +943,24 @@ int GenomeMatcherImpl::prefixMatch(string const &a, string const &b,
   return matchedLength;
 }
 
+//******************** QueryContext functions *********************************
+
+QueryContext::QueryContext() { m_impl = new QueryContextImpl; }
+
+QueryContext::~QueryContext() { delete m_impl; }
+
 //******************** GenomeMatcher functions ********************************
 
 // These functions simply delegate to GenomeMatcherImpl's functions.
 // You probably don't want to change any of this code.
 
 GenomeMatcher::GenomeMatcher(int minSearchLength) {
-  m_impl = new GenomeMatcherImpl(minSearchLength);
+  m_impl = new GenomeMatcherImpl(minSearchLength, GenomeMatcherOptions());
+}
+
+GenomeMatcher::GenomeMatcher(int minSearchLength,
+                             const GenomeMatcherOptions &options) {
+  m_impl = new GenomeMatcherImpl(minSearchLength, options);
 }
 
 GenomeMatcher::~GenomeMatcher() { delete m_impl; }
@@ -231,6 +973,14 @@ int GenomeMatcher::minimumSearchLength() const {
   return m_impl->minimumSearchLength();
 }
 
+size_t GenomeMatcher::resultCacheHits() const {
+  return m_impl->resultCacheHits();
+}
+
+size_t GenomeMatcher::resultCacheMisses() const {
+  return m_impl->resultCacheMisses();
+}
+
 bool GenomeMatcher::findGenomesWithThisDNA(const string &fragment,
                                            int minimumLength,
                                            bool exactMatchOnly,
@@ -239,6 +989,29 @@ bool GenomeMatcher::findGenomesWithThisDNA(const string &fragment,
                                         matches);
 }
 
+bool GenomeMatcher::findGenomesWithThisDNA(const string &fragment,
+                                           int minimumLength,
+                                           bool exactMatchOnly,
+                                           vector<DNAMatch> &matches,
+                                           QueryContext &context) const {
+  return m_impl->findGenomesWithThisDNA(fragment, minimumLength,
+                                        exactMatchOnly, matches, context);
+}
+
+bool GenomeMatcher::findAllMatchesOfThisDNA(const string &fragment,
+                                            int minimumLength,
+                                            bool exactMatchOnly,
+                                            vector<DNAMatch> &matches) const {
+  return m_impl->findAllMatchesOfThisDNA(fragment, minimumLength,
+                                         exactMatchOnly, matches);
+}
+
+bool GenomeMatcher::findGenomesWithinEditDistance(
+    const string &fragment, int maxEdits,
+    vector<DNAEditMatch> &matches) const {
+  return m_impl->findGenomesWithinEditDistance(fragment, maxEdits, matches);
+}
+
 bool GenomeMatcher::findRelatedGenomes(const Genome &query,
                                        int fragmentMatchLength,
                                        bool exactMatchOnly,
@@ -247,3 +1020,13 @@ bool GenomeMatcher::findRelatedGenomes(const Genome &query,
   return m_impl->findRelatedGenomes(query, fragmentMatchLength, exactMatchOnly,
                                     matchPercentThreshold, results);
 }
+
+bool GenomeMatcher::findRelatedGenomes(const Genome &query,
+                                       int fragmentMatchLength,
+                                       bool exactMatchOnly,
+                                       double matchPercentThreshold,
+                                       int stride,
+                                       vector<GenomeMatch> &results) const {
+  return m_impl->findRelatedGenomes(query, fragmentMatchLength, exactMatchOnly,
+                                    matchPercentThreshold, stride, results);
+}
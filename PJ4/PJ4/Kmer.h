@@ -0,0 +1,162 @@
+//
+//  Kmer.h
+//  PJ4
+//
+//  Created by Jim Zenn on 10/19/26.
+//  Copyright © 2019 UCLA. All rights reserved.
+//
+
+#ifndef Kmer_h
+#define Kmer_h
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// the longest K-mer that can be packed into a 64-bit code, two bits per base
+int const MAX_PACKED_KMER_LENGTH = 32;
+
+// the 2-bit code of a base, or -1 if it is not one of A, C, G and T
+inline int baseCode(char base) {
+  switch (base) {
+  case 'A':
+    return 0;
+  case 'C':
+    return 1;
+  case 'G':
+    return 2;
+  case 'T':
+    return 3;
+  default:
+    return -1;
+  }
+}
+
+// pack the K-mer into a 64-bit code, first base in the most significant bits.
+// Fail if the K-mer is too long or contains anything but A, C, G and T.
+inline bool packKmer(const string &kmer, uint64_t &code) {
+  if (kmer.size() > static_cast<size_t>(MAX_PACKED_KMER_LENGTH))
+    return false;
+  code = 0;
+  for (char const base : kmer) {
+    int const bits = baseCode(base);
+    if (bits < 0)
+      return false;
+    code = (code << 2) | static_cast<uint64_t>(bits);
+  }
+  return true;
+}
+
+// unpack a code made by packKmer back into its K bases
+inline void unpackKmer(uint64_t code, int k, string &kmer) {
+  kmer.resize(k);
+  for (int i = k - 1; i >= 0; i--, code >>= 2)
+    kmer[i] = "ACGT"[code & 3];
+}
+
+// sort the (code, value) pairs by the low nBits bits of their codes with an
+// LSD radix sort, a byte per pass; the sort is stable, and passes over a byte
+// shared by every code are skipped
+template <typename V>
+void radixSortByCode(vector<pair<uint64_t, V>> &entries, int nBits = 64) {
+  if (entries.empty())
+    return;
+  // copied rather than sized, as V may not be default constructible
+  vector<pair<uint64_t, V>> sorted = entries;
+  for (int shift = 0; shift < nBits; shift += 8) {
+    size_t counts[257] = {};
+    for (auto const &entry : entries)
+      counts[((entry.first >> shift) & 0xff) + 1]++;
+    if (counts[((entries[0].first >> shift) & 0xff) + 1] == entries.size())
+      continue;
+    // counts[digit] becomes where the entries with the digit start
+    for (int digit = 0; digit < 256; digit++)
+      counts[digit + 1] += counts[digit];
+    for (auto const &entry : entries)
+      sorted[counts[(entry.first >> shift) & 0xff]++] = entry;
+    entries.swap(sorted);
+  }
+}
+
+// scramble the bits of a 64-bit value (the MurmurHash3 finalizer), so that
+// similar K-mers end up with unrelated hashes
+inline uint64_t mixHash(uint64_t x) {
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+// a well-mixed 64-bit hash of a K-mer, e.g. for Bloom filter lookups
+inline uint64_t hashKmer(const string &kmer) {
+  uint64_t code;
+  if (packKmer(kmer, code))
+    return mixHash(code);
+  // too long to pack or contains N; fall back to FNV-1a
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (char const ch : kmer)
+    hash = (hash ^ static_cast<unsigned char>(ch)) * 0x100000001b3ULL;
+  return mixHash(hash);
+}
+
+// compute the hash of every K-mer of seq; hashes[i] is the hash of the K-mer
+// starting at position i. A polynomial rolling hash is used so that each step
+// costs O(1) regardless of K.
+inline void hashKmers(const string &seq, int k, vector<uint64_t> &hashes) {
+  hashes.clear();
+  int const n = static_cast<int>(seq.size());
+  if (k <= 0 || n < k)
+    return;
+  uint64_t const base = 0x100000001b3ULL;
+  uint64_t topPower = 1; // base^(k-1), the weight of the outgoing char
+  for (int i = 1; i < k; i++)
+    topPower *= base;
+  uint64_t rolling = 0;
+  for (int i = 0; i < k; i++)
+    rolling = rolling * base + static_cast<unsigned char>(seq[i]);
+  hashes.reserve(n - k + 1);
+  hashes.push_back(mixHash(rolling));
+  for (int i = k; i < n; i++) {
+    rolling -= topPower * static_cast<unsigned char>(seq[i - k]);
+    rolling = rolling * base + static_cast<unsigned char>(seq[i]);
+    hashes.push_back(mixHash(rolling));
+  }
+}
+
+// find the (w,k)-minimizers of seq: for every window of w consecutive K-mers,
+// the position of the K-mer with the smallest hash (ties go to the leftmost
+// one). Each position is reported once, in increasing order. A sequence
+// shorter than a full window is treated as one partial window.
+inline void findMinimizers(const string &seq, int k, int w,
+                           vector<int> &positions) {
+  positions.clear();
+  vector<uint64_t> hashes;
+  hashKmers(seq, k, hashes);
+  int const nKmers = static_cast<int>(hashes.size());
+  if (nKmers == 0)
+    return;
+  if (w < 1)
+    w = 1;
+  // positions of candidate minimizers; their hashes increase from front to
+  // back, so the front is always the minimizer of the current window
+  deque<int> candidates;
+  for (int i = 0; i < nKmers; i++) {
+    while (!candidates.empty() && hashes[candidates.back()] > hashes[i])
+      candidates.pop_back();
+    candidates.push_back(i);
+    if (candidates.front() <= i - w)
+      candidates.pop_front();
+    bool const windowComplete = i >= w - 1 || i == nKmers - 1;
+    if (windowComplete &&
+        (positions.empty() || positions.back() != candidates.front()))
+      positions.push_back(candidates.front());
+  }
+}
+
+#endif /* Kmer_h */
@@ -0,0 +1,117 @@
+//
+//  KmerHash.h
+//  PJ4
+//
+//  Created by Jim Zenn on 10/19/26.
+//  Copyright © 2019 UCLA. All rights reserved.
+//
+
+#ifndef KmerHash_h
+#define KmerHash_h
+
+#include "Kmer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// An open-addressing hash table from packed K-mer codes to values. The values
+// of each code are stored contiguously, so a lookup is one probe sequence
+// followed by a sequential read.
+//
+// Inserted values are staged and only merged into the table when it is next
+// searched, since keeping the values of a code contiguous means rebuilding
+// the value array.
+template <typename V> class KmerHashTable {
+public:
+  KmerHashTable() {}
+  void insert(uint64_t code, const V &value) {
+    m_pending.emplace_back(code, value);
+    m_sealed.store(false, memory_order_release);
+  }
+  // append the values stored under the code to found
+  void find(uint64_t code, vector<V> &found) const {
+    seal();
+    if (m_slots.empty())
+      return;
+    size_t const mask = m_slots.size() - 1;
+    for (size_t i = mixHash(code) & mask; m_slots[i].count != 0;
+         i = (i + 1) & mask) {
+      if (m_slots[i].code == code) {
+        found.insert(found.end(), m_values.begin() + m_slots[i].begin,
+                     m_values.begin() + m_slots[i].begin + m_slots[i].count);
+        return;
+      }
+    }
+  }
+  // C++11 syntax for preventing copying and assignment
+  KmerHashTable(const KmerHashTable &) = delete;
+  KmerHashTable &operator=(const KmerHashTable &) = delete;
+
+private:
+  struct Slot {
+    uint64_t code;
+    uint32_t begin; // index of the first value of this code in m_values
+    uint32_t count; // number of values of this code; 0 for an empty slot
+  };
+  // merge the staged values into the table
+  void seal() const;
+
+  mutable vector<Slot> m_slots; // size is always a power of 2
+  mutable vector<V> m_values;   // grouped by code, in insertion order
+  mutable vector<pair<uint64_t, V>> m_pending;
+  mutable atomic<bool> m_sealed{true};
+  mutable mutex m_sealMutex;
+};
+
+template <typename V> void KmerHashTable<V>::seal() const {
+  if (m_sealed.load(memory_order_acquire))
+    return;
+  lock_guard<mutex> lock(m_sealMutex);
+  if (m_sealed.load(memory_order_relaxed))
+    return;
+  // put the values already in the table before the staged ones, so that the
+  // values of every code stay in insertion order after the stable sort
+  vector<pair<uint64_t, V>> entries;
+  entries.reserve(m_values.size() + m_pending.size());
+  for (auto const &slot : m_slots)
+    for (uint32_t i = 0; i < slot.count; i++)
+      entries.emplace_back(slot.code, m_values[slot.begin + i]);
+  entries.insert(entries.end(), m_pending.begin(), m_pending.end());
+  m_pending.clear();
+  m_pending.shrink_to_fit();
+  radixSortByCode(entries);
+  size_t nCodes = 0;
+  for (size_t i = 0; i < entries.size(); i++)
+    if (i == 0 || entries[i].first != entries[i - 1].first)
+      nCodes++;
+  // keep the load factor at or below one half
+  size_t capacity = 1;
+  while (capacity < 2 * nCodes)
+    capacity <<= 1;
+  m_slots.assign(capacity, Slot{0, 0, 0});
+  m_values.clear();
+  m_values.reserve(entries.size());
+  size_t const mask = capacity - 1;
+  for (size_t first = 0; first < entries.size();) {
+    uint64_t const code = entries[first].first;
+    size_t last = first;
+    while (last < entries.size() && entries[last].first == code)
+      m_values.push_back(entries[last++].second);
+    size_t i = mixHash(code) & mask;
+    while (m_slots[i].count != 0)
+      i = (i + 1) & mask;
+    m_slots[i].code = code;
+    m_slots[i].begin = static_cast<uint32_t>(first);
+    m_slots[i].count = static_cast<uint32_t>(last - first);
+    first = last;
+  }
+  m_sealed.store(true, memory_order_release);
+}
+
+#endif /* KmerHash_h */
@@ -0,0 +1,85 @@
+//
+//  LRUCache.h
+//  PJ4
+//
+//  Created by Jim Zenn on 10/19/26.
+//  Copyright © 2019 UCLA. All rights reserved.
+//
+
+#ifndef LRUCache_h
+#define LRUCache_h
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+using namespace std;
+
+// A bounded map that evicts the least recently used entry when full. Every
+// operation takes a lock, so a cache can be shared by concurrent queries.
+template <typename K, typename V> class LRUCache {
+public:
+  LRUCache(size_t capacity) : m_capacity(capacity) {}
+  // copy the value cached under the key to value and mark it as recently
+  // used; false if the key is not cached
+  bool get(const K &key, V &value) {
+    lock_guard<mutex> lock(m_mutex);
+    auto const it = m_positions.find(key);
+    if (it == m_positions.end()) {
+      m_misses++;
+      return false;
+    }
+    m_hits++;
+    // move the entry to the front, which holds the most recently used
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    value = it->second->second;
+    return true;
+  }
+  void put(const K &key, const V &value) {
+    lock_guard<mutex> lock(m_mutex);
+    if (m_capacity == 0)
+      return;
+    auto const it = m_positions.find(key);
+    if (it != m_positions.end()) {
+      it->second->second = value;
+      m_entries.splice(m_entries.begin(), m_entries, it->second);
+      return;
+    }
+    if (m_entries.size() == m_capacity) {
+      m_positions.erase(m_entries.back().first);
+      m_entries.pop_back();
+    }
+    m_entries.emplace_front(key, value);
+    m_positions.emplace(key, m_entries.begin());
+  }
+  // forget every entry; the counters are kept
+  void clear() {
+    lock_guard<mutex> lock(m_mutex);
+    m_entries.clear();
+    m_positions.clear();
+  }
+  size_t hits() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_hits;
+  }
+  size_t misses() const {
+    lock_guard<mutex> lock(m_mutex);
+    return m_misses;
+  }
+  // C++11 syntax for preventing copying and assignment
+  LRUCache(const LRUCache &) = delete;
+  LRUCache &operator=(const LRUCache &) = delete;
+
+private:
+  typedef list<pair<K, V>> EntryList; // most recently used first
+  size_t const m_capacity;
+  EntryList m_entries;
+  unordered_map<K, typename EntryList::iterator> m_positions;
+  size_t m_hits = 0;
+  size_t m_misses = 0;
+  mutable mutex m_mutex;
+};
+
+#endif /* LRUCache_h */
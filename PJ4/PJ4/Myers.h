@@ -0,0 +1,143 @@
+//
+//  Myers.h
+//  PJ4
+//
+//  Created by Jim Zenn on 10/19/26.
+//  Copyright © 2019 UCLA. All rights reserved.
+//
+
+#ifndef Myers_h
+#define Myers_h
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Myers' bit-parallel edit distance, with the pattern split into 64-base
+// words as in Hyyrö's blocked variant. Each text char updates one column of
+// the dynamic programming matrix a word at a time, so scanning a text of n
+// chars costs O(n * ceil(m / 64)) word operations for a pattern of m chars.
+class MyersPattern {
+public:
+  MyersPattern(const string &pattern);
+  int length() const { return m_length; }
+  // the smallest edit distance between the pattern and any substring of the
+  // text; bestEnd is set past the end of the leftmost such substring
+  int search(const char *text, int textLength, int &bestEnd) const;
+  // the smallest edit distance between the pattern and any prefix of the
+  // text; bestLength is set to the length of the shortest such prefix
+  int align(const char *text, int textLength, int &bestLength) const;
+
+private:
+  static int const WORD_BITS = 64;
+  static int const N_SYMBOLS = 5; // A, C, G, T and anything else
+  static int symbolOf(char c);
+  // scan the text, calling the visitor with every column's distance; when
+  // anchored, the pattern must start at the first char of the text
+  template <typename Visitor>
+  void scan(const char *text, int textLength, bool anchored,
+            Visitor visit) const;
+
+  int m_length;
+  int m_nWords;
+  // the bits of the pattern positions holding each symbol, word by word
+  vector<uint64_t> m_peq; // m_peq[word * N_SYMBOLS + symbol]
+};
+
+inline MyersPattern::MyersPattern(const string &pattern)
+    : m_length(static_cast<int>(pattern.size())),
+      m_nWords((m_length + WORD_BITS - 1) / WORD_BITS),
+      m_peq(static_cast<size_t>(m_nWords) * N_SYMBOLS, 0) {
+  for (int i = 0; i < m_length; i++)
+    m_peq[(i / WORD_BITS) * N_SYMBOLS + symbolOf(pattern[i])] |=
+        uint64_t(1) << (i % WORD_BITS);
+}
+
+inline int MyersPattern::symbolOf(char c) {
+  switch (c) {
+  case 'A':
+    return 0;
+  case 'C':
+    return 1;
+  case 'G':
+    return 2;
+  case 'T':
+    return 3;
+  default:
+    return 4;
+  }
+}
+
+template <typename Visitor>
+void MyersPattern::scan(const char *text, int textLength, bool anchored,
+                        Visitor visit) const {
+  // the vertical deltas of the current column, +1 in Pv and -1 in Mv
+  vector<uint64_t> pv(m_nWords, ~uint64_t(0)), mv(m_nWords, 0);
+  // the last row of column 0 is the pattern length
+  int distance = m_length;
+  for (int j = 0; j < textLength; j++) {
+    uint64_t const *peq = &m_peq[symbolOf(text[j])];
+    // the delta entering the top row: 0 when the match may start anywhere,
+    // +1 when it has to start at the first char of the text
+    int hin = anchored ? 1 : 0;
+    for (int w = 0; w < m_nWords; w++, peq += N_SYMBOLS) {
+      // the last row of the last word is the last pattern char
+      int const lastBit =
+          w == m_nWords - 1 ? (m_length - 1) % WORD_BITS : WORD_BITS - 1;
+      uint64_t const highBit = uint64_t(1) << lastBit;
+      uint64_t eq = *peq;
+      uint64_t const xv = eq | mv[w];
+      if (hin < 0)
+        eq |= 1;
+      uint64_t const xh = (((eq & pv[w]) + pv[w]) ^ pv[w]) | eq;
+      uint64_t ph = mv[w] | ~(xh | pv[w]);
+      uint64_t mh = pv[w] & xh;
+      int hout = 0;
+      if (ph & highBit)
+        hout = 1;
+      else if (mh & highBit)
+        hout = -1;
+      ph <<= 1;
+      mh <<= 1;
+      if (hin < 0)
+        mh |= 1;
+      else if (hin > 0)
+        ph |= 1;
+      pv[w] = mh | ~(xv | ph);
+      mv[w] = ph & xv;
+      hin = hout;
+    }
+    distance += hin;
+    visit(j, distance);
+  }
+}
+
+inline int MyersPattern::search(const char *text, int textLength,
+                                int &bestEnd) const {
+  int best = m_length;
+  bestEnd = 0;
+  scan(text, textLength, false, [&](int j, int distance) {
+    if (distance < best) {
+      best = distance;
+      bestEnd = j + 1;
+    }
+  });
+  return best;
+}
+
+inline int MyersPattern::align(const char *text, int textLength,
+                               int &bestLength) const {
+  int best = m_length;
+  bestLength = 0;
+  scan(text, textLength, true, [&](int j, int distance) {
+    if (distance < best) {
+      best = distance;
+      bestLength = j + 1;
+    }
+  });
+  return best;
+}
+
+#endif /* Myers_h */
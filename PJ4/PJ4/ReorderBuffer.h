@@ -0,0 +1,70 @@
+//
+//  ReorderBuffer.h
+//  PJ4
+//
+//  Created by Jim Zenn on 10/19/26.
+//  Copyright © 2019 UCLA. All rights reserved.
+//
+
+#ifndef ReorderBuffer_h
+#define ReorderBuffer_h
+
+#include <condition_variable>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <utility>
+
+using namespace std;
+
+// A buffer between threads that hands out items in the order of their
+// sequence numbers (0, 1, 2, ...), whatever order they are put in. Producers
+// block while their item is capacity or more ahead of the next one to be
+// taken, so a fast stage cannot run arbitrarily far ahead of a slow one.
+template <typename T> class ReorderBuffer {
+public:
+  ReorderBuffer(size_t capacity) : m_capacity(capacity) {}
+  void put(size_t sequence, T item) {
+    unique_lock<mutex> lock(m_mutex);
+    m_notFull.wait(lock, [&] { return sequence < m_next + m_capacity; });
+    m_items.emplace(sequence, move(item));
+    if (sequence == m_next)
+      m_nextReady.notify_one();
+  }
+  // take the item with the next sequence number; false once the buffer is
+  // closed without it
+  bool take(T &item) {
+    unique_lock<mutex> lock(m_mutex);
+    m_nextReady.wait(lock, [this] {
+      return m_items.count(m_next) != 0 || m_closed;
+    });
+    auto const next = m_items.find(m_next);
+    if (next == m_items.end())
+      return false;
+    item = move(next->second);
+    m_items.erase(next);
+    m_next++;
+    m_notFull.notify_all();
+    return true;
+  }
+  // tell the consumer that nothing more will be put
+  void close() {
+    lock_guard<mutex> lock(m_mutex);
+    m_closed = true;
+    m_nextReady.notify_all();
+  }
+  // C++11 syntax for preventing copying and assignment
+  ReorderBuffer(const ReorderBuffer &) = delete;
+  ReorderBuffer &operator=(const ReorderBuffer &) = delete;
+
+private:
+  size_t const m_capacity;
+  map<size_t, T> m_items; // by sequence number
+  size_t m_next = 0;      // the sequence number of the next item to take
+  bool m_closed = false;
+  mutex m_mutex;
+  condition_variable m_notFull;
+  condition_variable m_nextReady;
+};
+
+#endif /* ReorderBuffer_h */
@@ -9,109 +9,288 @@
 #ifndef Trie_h
 #define Trie_h
 
+#include "Alphabet.h"
+#include "Arena.h"
+
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <new>
 #include <string>
+#include <type_traits>
 #include <vector>
 
 using namespace std;
 
-template <typename V> class Trie {
+// The nodes of the trie and their values all live in an arena owned by the
+// trie, so building it does not call malloc for every node, and destroying it
+// frees a handful of blocks instead of walking every node.
+//
+// Each node keeps an array with one child slot per symbol of the Alphabet
+// (see Alphabet.h), so finding a child is a single array access. Keys with
+// symbols outside the alphabet are not inserted.
+template <typename V, typename Alphabet = ByteAlphabet> class Trie {
 public:
   Trie() {}
-  ~Trie() { delete m_root; }
+  // a trie whose nodes live in an arena with the given options
+  Trie(const ArenaOptions &arenaOptions) : m_arena(arenaOptions) {}
+  ~Trie() { destroyValues(); }
   void reset() {
-    delete m_root;           // delete the nodes recursively
-    m_root = new Node('\0'); // create a new node
+    destroyValues();
+    m_arena.release();      // free every node at once
+    m_root = newNode();     // create a new node
   }
-  void insert(const string &key, const V &value) { m_root->insert(key, value); }
+  void insert(const string &key, const V &value) {
+    if (!isValidKey(key))
+      return;
+    Node *node = m_root;
+    for (char const symbol : key)
+      node = node->getOrCreateChild(symbol, m_arena);
+    node->add(&value, 1, m_arena);
+  }
+  // Inserts keys arriving in sorted order, as in a bulk load (see below).
+  class SortedInserter;
   vector<V> find(const string &key, bool exactMatchOnly) const {
-    return exactMatchOnly ? m_root->findExact(key)
-                          : m_root->findSNiP(key, true);
+    vector<V> found;
+    find(key, exactMatchOnly, found);
+    return found;
+  }
+  // same as above, but append the values to found instead
+  void find(const string &key, bool exactMatchOnly, vector<V> &found) const {
+    if (exactMatchOnly)
+      m_root->findExact(key, 0, found);
+    else
+      m_root->findSNiP(key, 0, true, NoPruning(), found);
+  }
+  // Same as find(key, false, found), but leave out the key itself if
+  // prune.skipsKey(), and the key with the symbol of the given index in place
+  // of key[depth] if prune.skipsSNiP(depth, index). Whatever knows which keys
+  // cannot be in the trie (a Bloom filter, say) can cut the walk short this
+  // way.
+  template <typename Prune>
+  void findSNiPs(const string &key, const Prune &prune,
+                 vector<V> &found) const {
+    m_root->findSNiP(key, 0, true, prune, found);
   }
   // C++11 syntax for preventing copying and assignment
   Trie(const Trie &) = delete;
   Trie &operator=(const Trie &) = delete;
 
 private:
+  // leaves nothing out
+  struct NoPruning {
+    bool skipsKey() const { return false; }
+    bool skipsSNiP(size_t /* depth */, int /* index */) const { return false; }
+  };
+  // A block of the values of a node, followed in memory by room for capacity
+  // of them. The arena never takes memory back, so a node's values are a
+  // chain of blocks that are filled in turn and never moved; a vector
+  // growing in the arena would leave each outgrown buffer behind. The chain
+  // is circular, so the node only points to its last block, and that block to
+  // the first.
+  struct Postings {
+    Postings *next;
+    uint32_t size;
+    uint32_t capacity;
+    // the values follow the header, aligned for V
+    static constexpr size_t valuesOffset =
+        (sizeof(Postings) + alignof(V) - 1) / alignof(V) * alignof(V);
+    V *values() {
+      return reinterpret_cast<V *>(reinterpret_cast<char *>(this) +
+                                   valuesOffset);
+    }
+    V const *values() const {
+      return reinterpret_cast<V const *>(
+          reinterpret_cast<char const *>(this) + valuesOffset);
+    }
+    static Postings *create(Arena &arena, size_t capacity) {
+      void *memory = arena.allocate(valuesOffset + capacity * sizeof(V),
+                                    max(alignof(Postings), alignof(V)));
+      return new (memory)
+          Postings{nullptr, 0, static_cast<uint32_t>(capacity)};
+    }
+  };
+  // blocks added one value at a time double up to this many values, which
+  // bounds the room left unused at the end of a node's last block
+  enum { MAX_POSTINGS_GROWTH = 32 };
   class Node {
   public:
-    Node(const char &label) : m_label(label) {}
-    ~Node() {
-      // destruct all child nodes first
-      for (auto const &child : m_children)
-        delete child;
-    }
+    Node() : m_children() {}
     // get the child with the given label. If none exist, return nullptr.
     Node *getChild(const char &label) const {
-      for (auto const &child : m_children)
-        if (child->m_label == label)
-          return child;
-      return nullptr;
+      int const index = Alphabet::index(label);
+      return index < 0 ? nullptr : m_children[index];
+    }
+    // get the child with the given label, creating it in the arena if none
+    // exists yet
+    Node *getOrCreateChild(const char &label, Arena &arena) {
+      Node *&child = m_children[Alphabet::index(label)];
+      if (child == nullptr)
+        child = create(arena);
+      return child;
+    }
+    // add the given values to this node; the values added at once land in
+    // a single block
+    void add(const V *values, size_t nValues, Arena &arena);
+    // destroy the values stored in the sub trie rooted with this node
+    void destroyValues();
+    // append the values at the node indexed exactly by key[depth..] to found
+    void findExact(const string &key, size_t depth, vector<V> &found) const;
+    // append the values at the node indexed by key[depth..] with one mismatch
+    // to found, but for those prune leaves out (see findSNiPs)
+    template <typename Prune>
+    void findSNiP(const string &key, size_t depth, const bool &first,
+                  const Prune &prune, vector<V> &found) const;
+
+    static Node *create(Arena &arena) {
+      return new (arena.allocate(sizeof(Node), alignof(Node))) Node();
     }
-    // add the given value to this node
-    void add(const V &value) { m_values.push_back(value); }
-    // insert the given value to the sub trie rooted with this node
-    void insert(const string &key, const V &value);
-    // return the values at the node indexed exactly by the given key
-    vector<V> findExact(const string &key) const;
-    // return the values at the node indexed by the given key with one mismatch
-    vector<V> findSNiP(const string &key, const bool &first) const;
 
   private:
-    char const m_label;        // this node's key label, should be const
-    vector<V> m_values;        // the values stored in this node
-    vector<Node *> m_children; // the child nodes of this node
+    // append the values stored in this node to found
+    void appendValues(vector<V> &found) const {
+      if (m_values == nullptr)
+        return;
+      Postings const *block = m_values;
+      do {
+        block = block->next;
+        found.insert(found.end(), block->values(),
+                     block->values() + block->size);
+      } while (block != m_values);
+    }
+
+    Postings *m_values = nullptr;     // the last block of values of this node
+    Node *m_children[Alphabet::size]; // the child for each symbol
   };
+  Node *newNode() { return Node::create(m_arena); }
+  // whether every symbol of the key is in the alphabet
+  static bool isValidKey(const string &key) {
+    for (char const symbol : key)
+      if (Alphabet::index(symbol) < 0)
+        return false;
+    return true;
+  }
+  // Nodes are never destructed one by one; only values that own resources
+  // outside the arena need their destructors run.
+  void destroyValues() {
+    if (!is_trivially_destructible<V>::value)
+      m_root->destroyValues();
+  }
+
+  Arena m_arena;                // holds every node; declared first
+  Node *m_root = newNode();     // the root node of the trie
+};
+
+// Inserts keys arriving in sorted order, as in a bulk load. The path to the
+// previous key is kept, so each key only walks down from where it departs
+// from the previous one; all the values of a key are added at once, so
+// they land contiguously. The trie must not be reset while it is in use.
+template <typename V, typename Alphabet>
+class Trie<V, Alphabet>::SortedInserter {
+public:
+  SortedInserter(Trie &trie) : m_trie(trie), m_path(1, trie.m_root) {}
+  void insert(const string &key, const V *values, size_t nValues) {
+    if (!m_trie.isValidKey(key))
+      return;
+    // keep the path of the prefix shared with the previous key
+    size_t depth = 0;
+    while (depth < key.size() && depth < m_lastKey.size() &&
+           key[depth] == m_lastKey[depth])
+      depth++;
+    m_path.resize(depth + 1);
+    for (; depth < key.size(); depth++)
+      m_path.push_back(
+          m_path.back()->getOrCreateChild(key[depth], m_trie.m_arena));
+    m_path.back()->add(values, nValues, m_trie.m_arena);
+    m_lastKey = key;
+  }
 
-  Node *m_root = new Node('\0'); // the root node of the trie
+private:
+  Trie &m_trie;
+  string m_lastKey;
+  vector<Node *> m_path; // m_path[i] is reached by the first i symbols
 };
 
-template <typename V>
-void Trie<V>::Node::insert(const string &key, const V &value) {
-  if (key.empty()) {
-    add(value);
+template <typename V, typename Alphabet>
+void Trie<V, Alphabet>::Node::add(const V *values, size_t nValues,
+                                  Arena &arena) {
+  if (nValues == 0)
     return;
+  Postings *block = m_values;
+  if (block == nullptr || block->capacity - block->size < nValues) {
+    // the values added at once get a block of their own if they do not fit
+    size_t capacity = nValues;
+    if (nValues == 1 && block != nullptr)
+      capacity = min<size_t>(2 * block->capacity, MAX_POSTINGS_GROWTH);
+    Postings *const added = Postings::create(arena, capacity);
+    // link the new block in after the last one, ahead of the first
+    added->next = block == nullptr ? added : block->next;
+    if (block != nullptr)
+      block->next = added;
+    m_values = block = added;
   }
-  char const keyLabel = key[0];
-  // find on which child should insert be performed
-  Node *child = getChild(keyLabel);
-  if (child == nullptr) {
-    // no child with the given label is found
-    // create new child with this label
-    child = new Node(keyLabel);
-    m_children.push_back(child);
+  for (size_t i = 0; i < nValues; i++)
+    new (block->values() + block->size++) V(values[i]);
+}
+
+template <typename V, typename Alphabet>
+void Trie<V, Alphabet>::Node::destroyValues() {
+  // walk the nodes with an explicit stack, since keys may be deep
+  vector<Node *> pending(1, this);
+  while (!pending.empty()) {
+    Node *node = pending.back();
+    pending.pop_back();
+    if (node->m_values != nullptr) {
+      Postings *block = node->m_values;
+      do {
+        block = block->next;
+        for (size_t i = 0; i < block->size; i++)
+          block->values()[i].~V();
+        block->size = 0;
+      } while (block != node->m_values);
+    }
+    for (Node *child : node->m_children)
+      if (child != nullptr)
+        pending.push_back(child);
   }
-  child->insert(key.substr(1), value);
 }
 
-template <typename V>
-vector<V> Trie<V>::Node::findExact(const string &key) const {
-  if (key.empty())
-    return m_values;
-  char const keyLabel = key[0];
-  Node *const next = getChild(keyLabel);
-  // if the child with the label does not exist, then no value corresponds
-  // with the given key; otherwise, continue to search the sub trie
-  return next == nullptr ? vector<V>() : next->findExact(key.substr(1));
+template <typename V, typename Alphabet>
+void Trie<V, Alphabet>::Node::findExact(const string &key, size_t depth,
+                                        vector<V> &found) const {
+  Node const *node = this;
+  for (; depth < key.size(); depth++) {
+    node = node->getChild(key[depth]);
+    // if the child with the label does not exist, then no value corresponds
+    // with the given key; otherwise, continue to search the sub trie
+    if (node == nullptr)
+      return;
+  }
+  node->appendValues(found);
 }
 
-template <typename V>
-vector<V> Trie<V>::Node::findSNiP(const string &key, const bool &first) const {
-  if (key.empty())
-    return m_values;
-  vector<V> result;
-  char const keyLabel = key[0];
-  for (auto const &child : m_children) {
-    vector<V> found;
-    if (child->m_label == keyLabel)
+template <typename V, typename Alphabet>
+template <typename Prune>
+void Trie<V, Alphabet>::Node::findSNiP(const string &key, size_t depth,
+                                       const bool &first, const Prune &prune,
+                                       vector<V> &found) const {
+  if (depth == key.size()) {
+    if (!prune.skipsKey())
+      appendValues(found);
+    return;
+  }
+  int const keyIndex = Alphabet::index(key[depth]);
+  for (int index = 0; index < Alphabet::size; index++) {
+    Node const *child = m_children[index];
+    if (child == nullptr)
+      continue;
+    if (index == keyIndex)
       // exact match on this char, still can do SNiP next time.
-      found = child->findSNiP(key.substr(1), false);
-    else if (!first)
+      child->findSNiP(key, depth + 1, false, prune, found);
+    else if (!first && !prune.skipsSNiP(depth, index))
       // SNiP mismatch here; must exact match from now on.
-      found = child->findExact(key.substr(1));
-    result.insert(result.end(), found.begin(), found.end());
+      child->findExact(key, depth + 1, found);
   }
-  return result;
 }
 
 #endif /* Trie_h */
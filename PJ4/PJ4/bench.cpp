@@ -0,0 +1,179 @@
+//
+//  bench.cpp
+//  PJ4
+//
+//  Created by Jim Zenn on 10/19/26.
+//  Copyright © 2019 UCLA. All rights reserved.
+//
+
+// Benchmark harness: builds a GenomeMatcher over a genome file with and
+// without huge pages, then times the same queries against both and counts
+// their data TLB misses.
+//
+// usage: bench <genome file> [min search length] [number of queries]
+
+#include "provided.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// Counts the data TLB misses of the calling thread between start() and
+// stop(), where the kernel lets us; available() is false otherwise.
+class TLBMissCounter {
+public:
+  TLBMissCounter() {
+#ifdef __linux__
+    perf_event_attr attr = {};
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.size = sizeof(attr);
+    attr.config = PERF_COUNT_HW_CACHE_DTLB |
+                  (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                  (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    m_fd = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+#endif
+  }
+  ~TLBMissCounter() {
+#ifdef __linux__
+    if (m_fd >= 0)
+      close(m_fd);
+#endif
+  }
+  bool available() const { return m_fd >= 0; }
+  void start() {
+#ifdef __linux__
+    if (m_fd >= 0) {
+      ioctl(m_fd, PERF_EVENT_IOC_RESET, 0);
+      ioctl(m_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+  uint64_t stop() {
+    uint64_t count = 0;
+#ifdef __linux__
+    if (m_fd >= 0) {
+      ioctl(m_fd, PERF_EVENT_IOC_DISABLE, 0);
+      if (read(m_fd, &count, sizeof(count)) != sizeof(count))
+        count = 0;
+    }
+#endif
+    return count;
+  }
+  // C++11 syntax for preventing copying and assignment
+  TLBMissCounter(const TLBMissCounter &) = delete;
+  TLBMissCounter &operator=(const TLBMissCounter &) = delete;
+
+private:
+  int m_fd = -1;
+};
+
+struct BenchResult {
+  double buildSeconds;
+  double querySeconds;
+  uint64_t tlbMisses;
+};
+
+BenchResult runBench(const vector<Genome> &genomes, int minSearchLength,
+                     const GenomeMatcherOptions &options,
+                     const vector<string> &queries) {
+  BenchResult result;
+  auto const buildStart = chrono::steady_clock::now();
+  GenomeMatcher matcher(minSearchLength, options);
+  for (auto const &genome : genomes)
+    matcher.addGenome(genome);
+  auto const queryStart = chrono::steady_clock::now();
+  QueryContext context;
+  vector<DNAMatch> matches;
+  TLBMissCounter counter;
+  counter.start();
+  for (size_t i = 0; i < queries.size(); i++)
+    matcher.findGenomesWithThisDNA(queries[i], minSearchLength, i % 2 == 0,
+                                   matches, context);
+  result.tlbMisses = counter.stop();
+  auto const queryEnd = chrono::steady_clock::now();
+  result.buildSeconds =
+      chrono::duration<double>(queryStart - buildStart).count();
+  result.querySeconds = chrono::duration<double>(queryEnd - queryStart).count();
+  return result;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc < 2) {
+    cout << "usage: " << argv[0]
+         << " <genome file> [min search length] [number of queries]" << endl;
+    return 1;
+  }
+  int const minSearchLength = argc > 2 ? atoi(argv[2]) : 12;
+  int const nQueries = argc > 3 ? atoi(argv[3]) : 200000;
+  ifstream genomeFile(argv[1]);
+  vector<Genome> genomes;
+  if (!genomeFile || !Genome::load(genomeFile, genomes) || genomes.empty()) {
+    cout << "Cannot load genomes from " << argv[1] << endl;
+    return 1;
+  }
+  // half the queries are taken from the library, half are random
+  mt19937 random(42);
+  vector<string> queries;
+  string fragment;
+  int const queryLength = 2 * minSearchLength;
+  for (int i = 0; i < nQueries; i++) {
+    Genome const &genome = genomes[random() % genomes.size()];
+    if (i % 4 < 2 && genome.length() > queryLength) {
+      genome.extract(random() % (genome.length() - queryLength), queryLength,
+                     fragment);
+    } else {
+      fragment.clear();
+      for (int j = 0; j < queryLength; j++)
+        fragment += "ACGT"[random() % 4];
+    }
+    queries.push_back(fragment);
+  }
+
+  GenomeMatcherOptions regularPages;
+  GenomeMatcherOptions hugePages;
+  hugePages.hugePages = true;
+  hugePages.prefaultIndex = true;
+  BenchResult const regular =
+      runBench(genomes, minSearchLength, regularPages, queries);
+  BenchResult const huge =
+      runBench(genomes, minSearchLength, hugePages, queries);
+
+  bool const countsTLBMisses = TLBMissCounter().available();
+  cout << fixed << setprecision(3);
+  cout << setw(16) << "" << setw(12) << "build (s)" << setw(12) << "query (s)"
+       << setw(16) << "dTLB misses" << endl;
+  for (auto const &row : {make_pair("regular pages", regular),
+                          make_pair("huge pages", huge)}) {
+    cout << setw(16) << row.first << setw(12) << row.second.buildSeconds
+         << setw(12) << row.second.querySeconds << setw(16);
+    if (countsTLBMisses)
+      cout << row.second.tlbMisses << endl;
+    else
+      cout << "n/a" << endl;
+  }
+  if (countsTLBMisses && regular.tlbMisses > 0)
+    cout << "huge pages cut dTLB misses by "
+         << 100.0 * (1.0 - static_cast<double>(huge.tlbMisses) /
+                               static_cast<double>(regular.tlbMisses))
+         << "%" << endl;
+  else
+    cout << "dTLB miss counters are not available on this system" << endl;
+  return 0;
+}
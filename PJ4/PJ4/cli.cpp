@@ -6,13 +6,17 @@
 //  Copyright © 2019 UCLA. All rights reserved.
 //
 
+#include "ReorderBuffer.h"
 #include "provided.h"
+#include <algorithm>
+#include <atomic>
 #include <cctype>
 #include <cstdlib>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <string>
+#include <thread>
 #include <vector>
 using namespace std;
 
@@ -65,17 +69,21 @@ void addOneGenomeManually(GenomeMatcher *library) {
   library->addGenome(Genome(name, sequence));
 }
 
-bool loadFile(string filename, vector<Genome> &genomes) {
+// load the genomes of the file; return what went wrong, or "" if nothing did
+string parseFile(string filename, vector<Genome> &genomes) {
   ifstream inputf(filename);
-  if (!inputf) {
-    cout << "Cannot open file: " << filename << endl;
-    return false;
-  }
-  if (!Genome::load(inputf, genomes)) {
-    cout << "Improperly formatted file: " << filename << endl;
-    return false;
-  }
-  return true;
+  if (!inputf)
+    return "Cannot open file: " + filename;
+  if (!Genome::load(inputf, genomes))
+    return "Improperly formatted file: " + filename;
+  return "";
+}
+
+bool loadFile(string filename, vector<Genome> &genomes) {
+  string const error = parseFile(filename, genomes);
+  if (!error.empty())
+    cout << error << endl;
+  return error.empty();
 }
 
 void loadOneDataFile(GenomeMatcher *library) {
@@ -95,14 +103,48 @@ void loadOneDataFile(GenomeMatcher *library) {
 }
 
 void loadProvidedFiles(GenomeMatcher *library) {
-  for (const string &f : providedFiles) {
+  // Parse the files concurrently, and index them on this thread in the order
+  // they are listed, so the library comes out the same on every run; the
+  // buffer keeps the parsers at most a few files ahead.
+  struct ParsedFile {
+    string name;
+    string error;
     vector<Genome> genomes;
-    if (loadFile(PROVIDED_DIR + "/" + f, genomes)) {
-      for (const auto &g : genomes)
-        library->addGenome(g);
-      cout << "Loaded " << genomes.size() << " genomes from " << f << endl;
+  };
+  size_t const nFiles = sizeof(providedFiles) / sizeof(providedFiles[0]);
+  size_t const nParsers =
+      max<size_t>(1, min<size_t>(thread::hardware_concurrency(), nFiles));
+  ReorderBuffer<ParsedFile> parsedFiles(nParsers + 2);
+  atomic<size_t> nextFile(0);
+  vector<thread> parsers;
+  for (size_t i = 0; i < nParsers; i++)
+    parsers.emplace_back([&] {
+      for (size_t f; (f = nextFile++) < nFiles;) {
+        ParsedFile parsed;
+        parsed.name = providedFiles[f];
+        parsed.error =
+            parseFile(PROVIDED_DIR + "/" + providedFiles[f], parsed.genomes);
+        parsedFiles.put(f, move(parsed));
+      }
+    });
+  // nothing more comes once every parser is done
+  thread closer([&] {
+    for (auto &parser : parsers)
+      parser.join();
+    parsedFiles.close();
+  });
+  ParsedFile parsed;
+  while (parsedFiles.take(parsed)) {
+    if (!parsed.error.empty()) {
+      cout << parsed.error << endl;
+      continue;
     }
+    for (const auto &g : parsed.genomes)
+      library->addGenome(g);
+    cout << "Loaded " << parsed.genomes.size() << " genomes from "
+         << parsed.name << endl;
   }
+  closer.join();
 }
 
 void findGenome(GenomeMatcher *library, bool exactMatch) {
@@ -204,16 +246,21 @@ void findRelatedGenomesFromFile(GenomeMatcher *library) {
     cout << "No file name entered." << endl;
     return;
   }
-  vector<Genome> genomes;
-  if (!loadFile(filename, genomes))
+  ifstream inputf(filename);
+  if (!inputf) {
+    cout << "Cannot open file: " << filename << endl;
     return;
+  }
   double pctThreshold;
   bool exactMatchOnly;
   if (!getFindRelatedParams(pctThreshold, exactMatchOnly))
     return;
 
   int minLength = library->minimumSearchLength();
-  for (const auto &g : genomes) {
+  // stream the genomes rather than loading the whole file first
+  GenomeReader reader(inputf);
+  Genome g("", "");
+  while (reader.next(g)) {
     vector<GenomeMatch> matches;
     library->findRelatedGenomes(g, 2 * minLength, exactMatchOnly, pctThreshold,
                                 matches);
@@ -229,6 +276,8 @@ void findRelatedGenomesFromFile(GenomeMatcher *library) {
       cout << "     " << setw(6) << m.percentMatch << "%  " << m.genomeName
            << endl;
   }
+  if (reader.failed())
+    cout << "Improperly formatted file: " << filename << endl;
 }
 
 void showMenu() {
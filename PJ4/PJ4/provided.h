@@ -23,19 +23,54 @@ public:
   ~Genome();
   Genome(const Genome &other);
   Genome &operator=(const Genome &rhs);
+  // Take over rhs's sequence without copying it.
+  Genome &operator=(Genome &&rhs);
   static bool load(istream &genomeSource, vector<Genome> &genomes);
   int length() const;
   string name() const;
   bool extract(int position, int length, string &fragment) const;
+  // Store the sequence in independently compressed blocks, trading some
+  // extract() speed for a much smaller footprint.
+  void compress();
 
 private:
   GenomeImpl *m_impl;
 };
 
+class GenomeReaderImpl;
+
+// Reads the genomes of a source in the format Genome::load accepts, one at a
+// time, so only the genome in use and the one after it are in memory. The
+// next genome is parsed on a background thread while the caller works on
+// the current one.
+class GenomeReader {
+public:
+  GenomeReader(istream &genomeSource);
+  ~GenomeReader();
+  // Read the next genome into genome; false at the end of the source, or if
+  // it is improperly formatted (see failed()).
+  bool next(Genome &genome);
+  bool failed() const;
+  // We prevent a GenomeReader object from being copied or assigned.
+  GenomeReader(const GenomeReader &) = delete;
+  GenomeReader &operator=(const GenomeReader &) = delete;
+
+private:
+  GenomeReaderImpl *m_impl;
+};
+
 struct DNAMatch {
   string genomeName;
   int length;
   int position;
+  int fragmentPosition; // where the match starts in the fragment
+};
+
+struct DNAEditMatch {
+  string genomeName;
+  int length;
+  int position;
+  int editDistance; // substitutions, insertions and deletions
 };
 
 struct GenomeMatch {
@@ -43,20 +78,95 @@ struct GenomeMatch {
   double percentMatch;
 };
 
+struct GenomeMatcherOptions {
+  // When greater than 1, only the (w,k)-minimizers of each genome are indexed,
+  // where w is this window size and k is the minimum search length. Matches
+  // of at least w+k-1 bases (2(w+k-1) when SNiPs are allowed) are still
+  // guaranteed to be found; shorter ones are found on a best-effort basis.
+  int minimizerWindow = 1;
+  enum IndexBackend { trieIndex, hashIndex };
+  // The data structure the keys are indexed in. The hash index packs each key
+  // into 64 bits and looks it up in one probe; it is only used when the
+  // minimum search length is at most 32, and it does not index keys
+  // containing N.
+  IndexBackend indexBackend = trieIndex;
+  // When positive, a Bloom filter over the indexed keys, spending about this
+  // many bits per key, lets queries whose keys were never indexed return
+  // without searching the index.
+  int bloomFilterBitsPerKey = 0;
+  // When positive, up to this many findGenomesWithThisDNA results are cached,
+  // evicting the least recently used; adding a genome empties the cache.
+  size_t resultCacheCapacity = 0;
+  // Whether the library's genomes are compressed (see Genome::compress) once
+  // indexed, for large libraries that are mostly queried through the index.
+  bool compressGenomes = false;
+  // Whether the trie index's memory is backed by huge pages, which cuts TLB
+  // misses once the index outgrows what regular pages can map, and whether
+  // its pages are faulted in as it is built rather than on first use.
+  bool hugePages = false;
+  bool prefaultIndex = false;
+};
+
 class GenomeMatcherImpl;
+class QueryContextImpl;
+
+// Scratch space for GenomeMatcher queries. Once its buffers have grown to fit,
+// a context lets findGenomesWithThisDNA run without allocating memory; give
+// each thread its own, since a context serves one query at a time.
+class QueryContext {
+public:
+  QueryContext();
+  ~QueryContext();
+  // We prevent a QueryContext object from being copied or assigned.
+  QueryContext(const QueryContext &) = delete;
+  QueryContext &operator=(const QueryContext &) = delete;
+
+private:
+  friend class GenomeMatcherImpl;
+  QueryContextImpl *m_impl;
+};
 
 class GenomeMatcher {
 public:
   GenomeMatcher(int minSearchLength);
+  GenomeMatcher(int minSearchLength, const GenomeMatcherOptions &options);
   ~GenomeMatcher();
   void addGenome(const Genome &genome);
   int minimumSearchLength() const;
+  // how many findGenomesWithThisDNA calls were answered from the result
+  // cache, and how many had to search
+  size_t resultCacheHits() const;
+  size_t resultCacheMisses() const;
   bool findGenomesWithThisDNA(const string &fragment, int minimumLength,
                               bool exactMatchOnly,
                               vector<DNAMatch> &matches) const;
+  // Same as above, using the scratch space of the given context.
+  bool findGenomesWithThisDNA(const string &fragment, int minimumLength,
+                              bool exactMatchOnly, vector<DNAMatch> &matches,
+                              QueryContext &context) const;
+  // Same as above, but report every maximal match instead of the longest one
+  // of each genome, grouped by genome and in increasing position. A match may
+  // start anywhere in the fragment (see DNAMatch::fragmentPosition), and
+  // cannot be extended either way without more mismatches than allowed.
+  bool findAllMatchesOfThisDNA(const string &fragment, int minimumLength,
+                               bool exactMatchOnly,
+                               vector<DNAMatch> &matches) const;
+  // Find, in each genome, the substring closest to the whole fragment by
+  // edit distance, if within maxEdits. The fragment must be at least
+  // (maxEdits + 1) * minimumSearchLength() long, or (maxEdits + 1) * (w + k
+  // - 1) long if only minimizers of window w are indexed (see
+  // GenomeMatcherOptions).
+  bool findGenomesWithinEditDistance(const string &fragment, int maxEdits,
+                                     vector<DNAEditMatch> &matches) const;
   bool findRelatedGenomes(const Genome &query, int fragmentMatchLength,
                           bool exactMatchOnly, double matchPercentThreshold,
                           vector<GenomeMatch> &results) const;
+  // Same as above, but slide a window of fragmentMatchLength bases over the
+  // query, stride bases at a time, instead of cutting it into adjacent
+  // fragments; a stride of 1 also finds matches straddling fragment edges.
+  bool findRelatedGenomes(const Genome &query, int fragmentMatchLength,
+                          bool exactMatchOnly, double matchPercentThreshold,
+                          int stride, vector<GenomeMatch> &results) const;
   // We prevent a GenomeMatcher object from being copied or assigned.
   GenomeMatcher(const GenomeMatcher &) = delete;
   GenomeMatcher &operator=(const GenomeMatcher &) = delete;
@@ -6,9 +6,25 @@
 //  Copyright © 2019 UCLA. All rights reserved.
 //
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <chrono>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <thread>
 
+#ifdef __linux__
+#include <malloc.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "Arena.h"
+#include "CompressedSequence.h"
+#include "ReorderBuffer.h"
 #include "Trie.h"
 #include "provided.h"
 
@@ -81,6 +97,85 @@ int main() {
 
   t.reset();
 
+  // the trie is usable again after a reset
+  query = "ABCD";
+  result = "";
+  for (auto i : t.find(query, true))
+    result += to_string(i) + " ";
+  assert(result == "");
+  t.insert("ABCD", 8);
+  for (auto i : t.find(query, true))
+    result += to_string(i) + " ";
+  assert(result == "8 ");
+  t.reset();
+
+  // values that own memory outside the trie's arena are still destructed
+  Trie<string> names;
+  names.insert("ACGT", "a fairly long name that does not fit in place");
+  names.insert("ACGA", "another fairly long name that does not fit in place");
+  assert(names.find("ACGT", false).size() == 2);
+  names.reset();
+  assert(names.find("ACGT", false).empty());
+  names.insert("ACGT", "a fairly long name that does not fit in place");
+
+  // tries over smaller alphabets
+  Trie<int, DNA4Alphabet> dna;
+  dna.insert("ACGT", 1);
+  dna.insert("ACGA", 2);
+  dna.insert("ACGN", 3); // N is not in the alphabet; nothing is inserted
+  assert(dna.find("acgt", true).size() == 1);
+  assert(dna.find("ACGC", false).size() == 2);
+  assert(dna.find("ACGN", false).size() == 2);
+  assert(dna.find("ACGN", true).empty());
+  Trie<int, ProteinAlphabet> protein;
+  protein.insert("MKWV", 1);
+  assert(protein.find("MKWV", true).size() == 1);
+  assert(protein.find("MKWY", false).size() == 1);
+
+  // pruned SNiP walks leave out what the pruning rules out, and only that
+  struct SkipA3 { // the key itself, and A in place of its last symbol
+    bool skipsKey() const { return true; }
+    bool skipsSNiP(size_t depth, int index) const {
+      return depth == 3 && index == DNA4Alphabet::index('A');
+    }
+  };
+  vector<int> pruned;
+  dna.findSNiPs("ACGC", SkipA3(), pruned);
+  assert(pruned == vector<int>{1});
+  pruned.clear();
+  dna.findSNiPs("ACGT", SkipA3(), pruned);
+  assert(pruned.empty());
+  pruned.clear();
+  dna.findSNiPs("ACTT", SkipA3(), pruned);
+  assert(pruned == vector<int>{1});
+
+  // bulk loads in sorted order agree with one-by-one inserts
+  Trie<int, DNA4Alphabet> bulk;
+  {
+    Trie<int, DNA4Alphabet>::SortedInserter inserter(bulk);
+    int const acga[] = {1, 2}, acgt[] = {3}, tt[] = {4};
+    inserter.insert("ACGA", acga, 2);
+    inserter.insert("ACGT", acgt, 1);
+    inserter.insert("TT", tt, 1);
+  }
+  bulk.insert("ACGT", 5);
+  assert(bulk.find("ACGA", true) == vector<int>({1, 2}));
+  assert(bulk.find("ACGT", true) == vector<int>({3, 5}));
+  assert(bulk.find("ACGC", false).size() == 4);
+  assert(bulk.find("TT", true).size() == 1);
+  // values added over time, one by one and several at once, keep their order
+  vector<int> expectedValues;
+  for (int i = 0; i < 200; i++) {
+    if (i % 50 == 0) {
+      int const several[] = {-i, -i - 1, -i - 2};
+      Trie<int, DNA4Alphabet>::SortedInserter(bulk).insert("GG", several, 3);
+      expectedValues.insert(expectedValues.end(), several, several + 3);
+    }
+    bulk.insert("GG", i);
+    expectedValues.push_back(i);
+  }
+  assert(bulk.find("GG", true) == expectedValues);
+
   // Genome Test
 
   // extract
@@ -101,6 +196,32 @@ int main() {
   assert(!result3);
   assert(f3 == "oops");
 
+  // load and stream
+
+  string const genomeFile = ">oryx\nGCTCGGNACA\nCATCC\n>ibex\nTTTT\n";
+  istringstream loadSource(genomeFile);
+  vector<Genome> loaded;
+  assert(Genome::load(loadSource, loaded));
+  assert(loaded.size() == 2);
+  istringstream readSource(genomeFile);
+  GenomeReader reader(readSource);
+  Genome read("", "");
+  for (auto const &genome : loaded) {
+    assert(reader.next(read));
+    string expected, actual;
+    genome.extract(0, genome.length(), expected);
+    read.extract(0, read.length(), actual);
+    assert(read.name() == genome.name() && actual == expected);
+  }
+  assert(!reader.next(read));
+  assert(!reader.failed());
+  istringstream badSource(">oryx\nGCTC\n>ibex\nTTXT\n");
+  GenomeReader badReader(badSource);
+  assert(badReader.next(read));
+  assert(read.name() == "oryx");
+  assert(!badReader.next(read));
+  assert(badReader.failed());
+
   // GenomeMatcher Test
 
   vector<DNAMatch> matches;
@@ -221,6 +342,475 @@ int main() {
   assert(relatedResults[1].genomeName == "Genome 2");
   assert(relatedResults[2].genomeName == "Genome 3");
 
+  // every hit of every genome, in order
+  success = matcher.findAllMatchesOfThisDNA("GAAG", 4, true, matches);
+  assert(success);
+  assert(matches.size() == 4);
+  assert(matches[0].genomeName == "Genome 1" && matches[0].position == 60);
+  assert(matches[1].genomeName == "Genome 2" && matches[1].position == 54);
+  assert(matches[2].genomeName == "Genome 3" && matches[2].position == 29);
+  assert(matches[3].genomeName == "Genome 3" && matches[3].position == 35);
+  // a match may start in the middle of the fragment
+  success = matcher.findAllMatchesOfThisDNA("TATACCGAAGGGTTCCGCTA", 6, true,
+                                            matches);
+  assert(success);
+  assert(matches.size() == 1);
+  assert(matches[0].genomeName == "Genome 1");
+  assert(matches[0].position == 57 && matches[0].fragmentPosition == 3);
+  assert(matches[0].length == 15);
+  // the longest of the hits of a genome at the start of the fragment is the
+  // match reported for it
+  for (bool exactMatchOnly : {true, false}) {
+    vector<DNAMatch> allMatches;
+    matcher.findAllMatchesOfThisDNA("GAAGGGTT", 5, exactMatchOnly, allMatches);
+    matcher.findGenomesWithThisDNA("GAAGGGTT", 5, exactMatchOnly, matches);
+    for (auto const &match : matches) {
+      int longest = 0;
+      for (auto const &hit : allMatches)
+        if (hit.genomeName == match.genomeName && hit.fragmentPosition == 0)
+          longest = max(longest, hit.length);
+      assert(longest == match.length);
+    }
+  }
+
+  // sliding windows with a stride of the window length score exactly like
+  // adjacent fragments
+  matcher.findRelatedGenomes(Genome("query", "CGCCAGTA"), 4, true, 49, 4,
+                             relatedResults);
+  assert(relatedResults.size() == 3);
+  assert(relatedResults[0].genomeName == "Genome 1");
+  assert(relatedResults[2].genomeName == "Genome 3");
+  matcher.findRelatedGenomes(Genome("query", "CGCCAGGGGG"), 4, true, 49, 4,
+                             relatedResults);
+  assert(relatedResults.size() == 1);
+  assert(relatedResults[0].genomeName == "Genome 1");
+  // sliding one base at a time, every window of a segment of Genome 1 matches
+  matcher.findRelatedGenomes(Genome("query", "CGCCAGTAC"), 4, true, 100, 1,
+                             relatedResults);
+  assert(relatedResults.size() == 1);
+  assert(relatedResults[0].genomeName == "Genome 1");
+  matcher.findRelatedGenomes(Genome("query", "CGCCAGTAC"), 4, false, 100, 1,
+                             relatedResults);
+  assert(relatedResults.size() == 2);
+  assert(relatedResults[0].genomeName == "Genome 1");
+  assert(relatedResults[1].genomeName == "Genome 3");
+
+  // Sparse (minimizer) index test
+
+  GenomeMatcherOptions sparseOptions;
+  sparseOptions.minimizerWindow = 3;
+  GenomeMatcher sparseMatcher(4, sparseOptions);
+  vector<Genome> sparseGenomes = {
+      Genome("Genome 1", "CGGTGTACNACGACTGGGGATAGAATATCTTGACGTCGTACCGGTTGTAGTCG"
+                         "TTCGACCGAAGGGTTCCGCGCCAGTAC"),
+      Genome("Genome 2", "TAACAGAGCGGTNATATTGTTACGAATCACGTGCGAGACTTAGAGCCAGAATA"
+                         "TGAAGTAGTGATTCAGCAACCAAGCGG"),
+      Genome("Genome 3", "TTTTGAGCCAGCGACGCGGCTTGCTTAACGAAGCGGAAGAGTAGGTTGGACAC"
+                         "ATTNGGCGGCACAGCGCTTTTGAGCCA")};
+  for (auto const &genome : sparseGenomes)
+    sparseMatcher.addGenome(genome);
+  // every exact match of at least w+k-1 = 6 bases is found, exactly as the
+  // dense index would find it
+  auto sortedByName = [](vector<DNAMatch> found) {
+    string summary;
+    sort(found.begin(), found.end(), [](DNAMatch const &a, DNAMatch const &b) {
+      return a.genomeName < b.genomeName;
+    });
+    for (auto const &match : found)
+      summary += match.genomeName + ":" + to_string(match.position) + ":" +
+                 to_string(match.length) + " ";
+    return summary;
+  };
+  for (auto const &genome : sparseGenomes) {
+    for (int pos = 0; pos + 8 <= genome.length(); pos++) {
+      string fragment;
+      genome.extract(pos, 8, fragment);
+      vector<DNAMatch> denseMatches, sparseMatches;
+      assert(sparseMatcher.findGenomesWithThisDNA(fragment, 6, true,
+                                                  sparseMatches));
+      matcher.findGenomesWithThisDNA(fragment, 6, true, denseMatches);
+      assert(sortedByName(sparseMatches) == sortedByName(denseMatches));
+    }
+  }
+  // Edit distance test
+
+  // one insertion and one deletion away from Genome 2
+  vector<DNAEditMatch> editMatches;
+  success = matcher.findGenomesWithinEditDistance("GTGCGTAGACTAGAGCCAGA", 2,
+                                                  editMatches);
+  assert(success);
+  assert(editMatches.size() == 1);
+  assert(editMatches[0].genomeName == "Genome 2");
+  assert(editMatches[0].position == 30);
+  assert(editMatches[0].length == 20);
+  assert(editMatches[0].editDistance == 2);
+  success = matcher.findGenomesWithinEditDistance("GTGCGTAGACTAGAGCCAGA", 1,
+                                                  editMatches);
+  assert(!success);
+  // too short to seed with 3 pieces of K bases
+  success = matcher.findGenomesWithinEditDistance("GAAGGGTTCCG", 2,
+                                                  editMatches);
+  assert(!success);
+  // every segment is found where it was taken from
+  for (auto const &genome : sparseGenomes) {
+    for (int pos = 0; pos + 12 <= genome.length(); pos += 7) {
+      string fragment;
+      genome.extract(pos, 12, fragment);
+      matcher.findGenomesWithinEditDistance(fragment, 2, editMatches);
+      bool found = false;
+      for (auto const &match : editMatches)
+        if (match.genomeName == genome.name())
+          found = match.editDistance == 0;
+      assert(found);
+    }
+  }
+  // the sparse index needs pieces of w+k-1 = 6 bases to seed every match
+  assert(!sparseMatcher.findGenomesWithinEditDistance("GAAGGGTTCCGC", 2,
+                                                      editMatches));
+  // and then finds every segment with an insertion and a deletion planted
+  for (auto const &genome : sparseGenomes) {
+    for (int pos = 0; pos + 21 <= genome.length(); pos += 3) {
+      string fragment;
+      genome.extract(pos, 21, fragment);
+      fragment.insert(5, "A");
+      fragment.erase(15, 1);
+      assert(sparseMatcher.findGenomesWithinEditDistance(fragment, 2,
+                                                         editMatches));
+      bool found = false;
+      for (auto const &match : editMatches)
+        if (match.genomeName == genome.name())
+          found = match.editDistance <= 2;
+      assert(found);
+    }
+  }
+
+  // Hash index test
+
+  GenomeMatcherOptions hashOptions;
+  hashOptions.indexBackend = GenomeMatcherOptions::hashIndex;
+  GenomeMatcher hashMatcher(4, hashOptions);
+  for (auto const &genome : sparseGenomes)
+    hashMatcher.addGenome(genome);
+  // both exact matches and SNiPs agree with the trie index on N-free queries;
+  // among equally long SNiPs, the two may report different positions
+  auto lengthsByName = [](vector<DNAMatch> found) {
+    for (auto &match : found)
+      match.position = 0;
+    return found;
+  };
+  for (auto const &genome : sparseGenomes) {
+    for (int pos = 0; pos + 8 <= genome.length(); pos++) {
+      string fragment;
+      genome.extract(pos, 8, fragment);
+      if (fragment.find('N') != string::npos)
+        continue;
+      for (bool exactMatchOnly : {true, false}) {
+        vector<DNAMatch> trieMatches, hashMatches;
+        hashMatcher.findGenomesWithThisDNA(fragment, 5, exactMatchOnly,
+                                           hashMatches);
+        matcher.findGenomesWithThisDNA(fragment, 5, exactMatchOnly,
+                                       trieMatches);
+        if (!exactMatchOnly) {
+          hashMatches = lengthsByName(hashMatches);
+          trieMatches = lengthsByName(trieMatches);
+        }
+        assert(sortedByName(hashMatches) == sortedByName(trieMatches));
+      }
+    }
+  }
+  // sliding windows roll their keys into the hash index's codes; the hash
+  // index skips keys with N, so query with the N-free part of each genome
+  for (auto const &genome : sparseGenomes) {
+    string sequence;
+    genome.extract(0, genome.length(), sequence);
+    Genome const query("query", sequence.substr(sequence.find('N') + 1));
+    vector<GenomeMatch> trieRelated, hashRelated;
+    matcher.findRelatedGenomes(query, 6, true, 0, 1, trieRelated);
+    hashMatcher.findRelatedGenomes(query, 6, true, 0, 1, hashRelated);
+    assert(trieRelated.size() == hashRelated.size());
+    for (size_t i = 0; i < trieRelated.size(); i++) {
+      assert(trieRelated[i].genomeName == hashRelated[i].genomeName);
+      assert(trieRelated[i].percentMatch == hashRelated[i].percentMatch);
+    }
+  }
+  // a query longer than the part of it read at a time still matches every
+  // window, those straddling the parts included
+  string longSequence;
+  unsigned longSeed = 1;
+  for (int i = 0; i < 150000; i++) {
+    longSeed = longSeed * 1103515245 + 12345;
+    longSequence += "ACGT"[(longSeed >> 16) % 4];
+  }
+  GenomeMatcher longMatcher(10), longHashMatcher(10, hashOptions);
+  longMatcher.addGenome(Genome("Long", longSequence));
+  longHashMatcher.addGenome(Genome("Long", longSequence));
+  for (int stride : {1, 7}) {
+    vector<GenomeMatch> trieRelated, hashRelated;
+    Genome const query("query", longSequence.substr(3));
+    longMatcher.findRelatedGenomes(query, 20, true, 100, stride, trieRelated);
+    longHashMatcher.findRelatedGenomes(query, 20, true, 100, stride,
+                                       hashRelated);
+    assert(trieRelated.size() == 1 && hashRelated.size() == 1);
+    assert(trieRelated[0].genomeName == "Long");
+    assert(hashRelated[0].genomeName == "Long");
+  }
+
+  // Bloom filter test
+
+  GenomeMatcherOptions bloomOptions;
+  bloomOptions.bloomFilterBitsPerKey = 10;
+  GenomeMatcher bloomMatcher(4, bloomOptions);
+  for (auto const &genome : sparseGenomes)
+    bloomMatcher.addGenome(genome);
+  // the filter never rejects a query that has matches
+  for (auto const &genome : sparseGenomes) {
+    for (int pos = 0; pos + 6 <= genome.length(); pos++) {
+      string fragment;
+      genome.extract(pos, 6, fragment);
+      for (bool exactMatchOnly : {true, false}) {
+        vector<DNAMatch> trieMatches, bloomMatches;
+        bloomMatcher.findGenomesWithThisDNA(fragment, 4, exactMatchOnly,
+                                            bloomMatches);
+        matcher.findGenomesWithThisDNA(fragment, 4, exactMatchOnly,
+                                       trieMatches);
+        assert(sortedByName(bloomMatches) == sortedByName(trieMatches));
+      }
+    }
+  }
+  assert(!bloomMatcher.findGenomesWithThisDNA("CCCCCC", 4, true, matches));
+  // nor do the SNiPs it prunes out of the walks of either index, whether a
+  // window's key is looked up as a string or by its rolled code
+  GenomeMatcherOptions hashBloomOptions = bloomOptions;
+  hashBloomOptions.indexBackend = GenomeMatcherOptions::hashIndex;
+  GenomeMatcher hashBloomMatcher(4, hashBloomOptions);
+  for (auto const &genome : sparseGenomes)
+    hashBloomMatcher.addGenome(genome);
+  for (auto const &genome : sparseGenomes) {
+    for (int pos = 0; pos + 6 <= genome.length(); pos++) {
+      string fragment;
+      genome.extract(pos, 6, fragment);
+      vector<DNAMatch> hashMatches, hashBloomMatches;
+      hashMatcher.findGenomesWithThisDNA(fragment, 4, false, hashMatches);
+      hashBloomMatcher.findGenomesWithThisDNA(fragment, 4, false,
+                                              hashBloomMatches);
+      assert(sortedByName(hashBloomMatches) == sortedByName(hashMatches));
+    }
+    for (GenomeMatcher const *plain : {&matcher, &hashMatcher}) {
+      GenomeMatcher const &pruned =
+          plain == &matcher ? bloomMatcher : hashBloomMatcher;
+      vector<GenomeMatch> plainRelated, prunedRelated;
+      plain->findRelatedGenomes(genome, 6, false, 0, 1, plainRelated);
+      pruned.findRelatedGenomes(genome, 6, false, 0, 1, prunedRelated);
+      assert(plainRelated.size() == prunedRelated.size());
+      for (size_t i = 0; i < plainRelated.size(); i++) {
+        assert(plainRelated[i].genomeName == prunedRelated[i].genomeName);
+        assert(plainRelated[i].percentMatch == prunedRelated[i].percentMatch);
+      }
+    }
+  }
+
+  success = sparseMatcher.findGenomesWithThisDNA("ACGTGCGAGACTTAGAGCG", 12,
+                                                 false, matches);
+  assert(success);
+  assert(matches.size() == 1);
+  assert(matches[0].genomeName == "Genome 2");
+  assert(matches[0].position == 28);
+  assert(matches[0].length == 19);
+
+  // Compressed genome test
+
+  // a sequence spanning several blocks, with repeats and runs of N
+  string repetitive;
+  unsigned seed = 12345;
+  while (repetitive.size() < 20000) {
+    seed = seed * 1103515245 + 12345;
+    if (seed % 7 == 0 && repetitive.size() > 500)
+      repetitive += repetitive.substr(repetitive.size() - 300, 300);
+    else if (seed % 11 == 0)
+      repetitive += string(1 + seed % 30, 'N');
+    else
+      repetitive += "ACGT"[(seed >> 16) % 4];
+  }
+  CompressedSequence const compressedSequence(repetitive, 1024, 2);
+  assert(compressedSequence.length() == static_cast<int>(repetitive.size()));
+  assert(compressedSequence.compressedSize() < repetitive.size() / 4);
+  for (int pos = 0; pos < compressedSequence.length(); pos += 997) {
+    int const len = min(3000, compressedSequence.length() - pos);
+    string fragment;
+    compressedSequence.extract(pos, len, fragment);
+    assert(fragment == repetitive.substr(pos, len));
+  }
+  // threads extracting at once evict each other's blocks from under them
+  vector<thread> extractors;
+  for (int t = 0; t < 4; t++)
+    extractors.emplace_back([&, t] {
+      for (int pos = t * 101; pos < compressedSequence.length(); pos += 389) {
+        int const len = min(1500, compressedSequence.length() - pos);
+        string fragment;
+        compressedSequence.extract(pos, len, fragment);
+        assert(fragment == repetitive.substr(pos, len));
+      }
+    });
+  for (auto &extractor : extractors)
+    extractor.join();
+  Genome compressedGenome("repetitive", repetitive);
+  compressedGenome.compress();
+  Genome const copiedGenome = compressedGenome;
+  string whole;
+  assert(copiedGenome.extract(0, copiedGenome.length(), whole));
+  assert(whole == repetitive);
+  assert(!copiedGenome.extract(copiedGenome.length() - 5, 6, whole));
+  // a matcher over compressed genomes finds the same matches
+  GenomeMatcherOptions compressOptions;
+  compressOptions.compressGenomes = true;
+  GenomeMatcher compressMatcher(4, compressOptions);
+  for (auto const &genome : sparseGenomes)
+    compressMatcher.addGenome(genome);
+  for (auto const &genome : sparseGenomes) {
+    for (int pos = 0; pos + 8 <= genome.length(); pos += 3) {
+      string fragment;
+      genome.extract(pos, 8, fragment);
+      vector<DNAMatch> plainMatches, compressedMatches;
+      matcher.findGenomesWithThisDNA(fragment, 5, true, plainMatches);
+      compressMatcher.findGenomesWithThisDNA(fragment, 5, true,
+                                             compressedMatches);
+      assert(sortedByName(plainMatches) == sortedByName(compressedMatches));
+    }
+  }
+
+  // Huge page test
+
+  GenomeMatcherOptions hugePageOptions;
+  hugePageOptions.hugePages = true;
+  hugePageOptions.prefaultIndex = true;
+  GenomeMatcher hugePageMatcher(4, hugePageOptions);
+  for (auto const &genome : sparseGenomes)
+    hugePageMatcher.addGenome(genome);
+  for (bool exactMatchOnly : {true, false}) {
+    vector<DNAMatch> hugePageMatches;
+    matcher.findGenomesWithThisDNA("GAATACG", 6, exactMatchOnly, matches);
+    hugePageMatcher.findGenomesWithThisDNA("GAATACG", 6, exactMatchOnly,
+                                           hugePageMatches);
+    assert(sortedByName(matches) == sortedByName(hugePageMatches));
+  }
+
+  // Arena test
+
+  // aligning in a nearly full block moves past its end; the allocation
+  // must then come from a new block
+  Arena arena(64);
+  for (int round = 0; round < 100; round++) {
+    char *const unaligned = static_cast<char *>(arena.allocate(61, 1));
+    char *const aligned = static_cast<char *>(arena.allocate(8, 64));
+    assert(reinterpret_cast<uintptr_t>(aligned) % 64 == 0);
+    assert(aligned >= unaligned + 61 || aligned + 8 <= unaligned);
+    fill(unaligned, unaligned + 61, 'A');
+    fill(aligned, aligned + 8, 'C');
+    assert(unaligned[60] == 'A');
+  }
+#if defined(__linux__) && !defined(__SANITIZE_ADDRESS__) &&                  \
+    !defined(__SANITIZE_THREAD__)
+  // with too little address space left to map huge pages in, the blocks
+  // come from malloc, and no more of them is handed out or prefaulted than
+  // malloc gave; tried in a child, so capping its address space leaves the
+  // other tests alone (the sanitizers need theirs uncapped)
+  pid_t const child = fork();
+  if (child == 0) {
+    ifstream statm("/proc/self/statm");
+    size_t nPages = 0;
+    statm >> nPages;
+    rlimit limit;
+    limit.rlim_cur = limit.rlim_max =
+        nPages * sysconf(_SC_PAGESIZE) + (1 << 20);
+    setrlimit(RLIMIT_AS, &limit);
+    ArenaOptions fallbackOptions;
+    fallbackOptions.blockSize = 1 << 16;
+    fallbackOptions.hugePages = true;
+    fallbackOptions.prefault = true;
+    Arena fallbackArena(fallbackOptions);
+    char *const first = static_cast<char *>(fallbackArena.allocate(1, 1));
+    char *const firstEnd = first + malloc_usable_size(first);
+    for (int i = 0; i < 8; i++) {
+      char *const bytes =
+          static_cast<char *>(fallbackArena.allocate(1 << 14, 1));
+      // inside the first block, or in another one
+      if (bytes < firstEnd && bytes + (1 << 14) > firstEnd)
+        _exit(1);
+      fill(bytes, bytes + (1 << 14), 'G');
+    }
+    _exit(0);
+  }
+  int childStatus = 0;
+  waitpid(child, &childStatus, 0);
+  assert(WIFEXITED(childStatus) && WEXITSTATUS(childStatus) == 0);
+#endif
+
+  // Query context test
+
+  // a context reused across queries gives the same answers
+  QueryContext context;
+  vector<DNAMatch> contextMatches;
+  for (auto const &genome : sparseGenomes) {
+    for (int pos = 0; pos + 8 <= genome.length(); pos += 5) {
+      string fragment;
+      genome.extract(pos, 8, fragment);
+      for (bool exactMatchOnly : {true, false}) {
+        matcher.findGenomesWithThisDNA(fragment, 5, exactMatchOnly, matches);
+        matcher.findGenomesWithThisDNA(fragment, 5, exactMatchOnly,
+                                       contextMatches, context);
+        assert(sortedByName(matches) == sortedByName(contextMatches));
+      }
+    }
+  }
+
+  // Result cache test
+
+  GenomeMatcherOptions cacheOptions;
+  cacheOptions.resultCacheCapacity = 2;
+  GenomeMatcher cacheMatcher(4, cacheOptions);
+  cacheMatcher.addGenome(sparseGenomes[0]);
+  cacheMatcher.addGenome(sparseGenomes[1]);
+  vector<DNAMatch> cachedMatches;
+  assert(cacheMatcher.findGenomesWithThisDNA("GAAG", 4, true, cachedMatches));
+  assert(cacheMatcher.findGenomesWithThisDNA("GAAG", 4, true, cachedMatches));
+  assert(cacheMatcher.resultCacheHits() == 1);
+  assert(cacheMatcher.resultCacheMisses() == 1);
+  assert(cachedMatches.size() == 2);
+  // the parameters are part of the key
+  cacheMatcher.findGenomesWithThisDNA("GAAG", 4, false, cachedMatches);
+  assert(cacheMatcher.resultCacheMisses() == 2);
+  // the least recently used entry is evicted
+  cacheMatcher.findGenomesWithThisDNA("GAATAC", 4, true, cachedMatches);
+  cacheMatcher.findGenomesWithThisDNA("GAAG", 4, true, cachedMatches);
+  assert(cacheMatcher.resultCacheMisses() == 4);
+  // a new genome invalidates the cache
+  cacheMatcher.addGenome(sparseGenomes[2]);
+  assert(cacheMatcher.findGenomesWithThisDNA("GAAG", 4, true, cachedMatches));
+  assert(cacheMatcher.resultCacheMisses() == 5);
+  assert(cachedMatches.size() == 3);
+
+  // Reorder buffer test
+  // items put out of order by several threads are taken in order
+  ReorderBuffer<int> reordered(3);
+  atomic<int> nextItem(0);
+  vector<thread> producers;
+  for (int p = 0; p < 4; p++)
+    producers.emplace_back([&] {
+      for (int item; (item = nextItem++) < 100;) {
+        this_thread::sleep_for(chrono::microseconds((item * 37) % 11));
+        reordered.put(item, item);
+      }
+    });
+  for (int expected = 0, item; expected < 100; expected++) {
+    assert(reordered.take(item));
+    assert(item == expected);
+  }
+  for (auto &producer : producers)
+    producer.join();
+  reordered.close();
+  int leftover;
+  assert(!reordered.take(leftover));
+
   cout << "Pass all tests!" << endl;
 
   return 0;